@@ -29,11 +29,15 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/time.h>
 
 #ifndef DISABLE_BROWSER
 
 static char **filelist = NULL;
 	/* The list of files to display in the file browser. */
+static browserentry *entries = NULL;
+	/* What is known about each of these files, in the same order. */
 static size_t filelist_len = 0;
 	/* The number of files in the list. */
 static int width = 0;
@@ -44,6 +48,32 @@ static size_t selected = 0;
 	/* The currently selected filename in the list; zero-based. */
 static char *path_save = NULL;
 	/* A copy of the current path. */
+#ifdef USE_PREFETCH
+static pthread_mutex_t entries_lock = PTHREAD_MUTEX_INITIALIZER;
+	/* Keeps the helper threads and the main one out of each other's
+	 * way when they touch the entries. */
+static pthread_cond_t files_wanted = PTHREAD_COND_INITIALIZER;
+	/* Signalled when there may be files for the helpers to look at. */
+static pthread_cond_t file_found = PTHREAD_COND_INITIALIZER;
+	/* Signalled whenever a helper has looked at a file. */
+static int helpers = 0;
+	/* The number of helper threads that are running. */
+static int report_fd = -1;
+	/* The end of the pipe that the helpers write to. */
+static bool reported = FALSE;
+	/* Whether there is a report in the pipe that wasn't read yet. */
+static size_t generation = 0;
+	/* Is incremented whenever the list of entries gets thrown away. */
+static size_t wanted_from = 0, shown_from = 0, wanted_to = 0;
+	/* The range of entries that the helpers should look at, and the
+	 * start of the part of it that is on the screen. */
+static size_t patient_page = (size_t)-1;
+	/* The first entry of the last page that was waited for. */
+#endif
+#ifdef USE_DIRWATCH
+static int browser_wd = -1;
+	/* The inotify watch on the browsed directory. */
+#endif
 
 /* Our main file browser function.  path is the tilde-expanded path we
  * start browsing from. */
@@ -69,6 +99,10 @@ char *do_browser(char *path, DIR *dir)
 
     UNSET(CONST_UPDATE);
 
+#ifdef USE_PREFETCH
+    start_helpers();
+#endif
+
     ans = mallocstrcpy(NULL, "");
 
   change_browser_directory:
@@ -84,14 +118,12 @@ char *do_browser(char *path, DIR *dir)
 
     assert(path != NULL && path[strlen(path) - 1] == '/');
 
-    /* Get the file list, and set longest and width in the process. */
+    /* Get the sorted file list, and set longest and width in the
+     * process. */
     browser_init(path, dir);
 
     assert(filelist != NULL);
 
-    /* Sort the file list. */
-    qsort(filelist, filelist_len, sizeof(char *), diralphasort);
-
     /* If prev_dir isn't NULL, select the directory saved in it, and
      * then blow it away. */
     if (prev_dir != NULL) {
@@ -121,9 +153,8 @@ char *do_browser(char *path, DIR *dir)
 
 #ifndef NANO_TINY
 	if (kbinput == KEY_WINCH) {
-	    /* Rebuild the file list and sort it. */
+	    /* Rebuild the file list. */
 	    browser_init(path_save, opendir(path_save));
-	    qsort(filelist, filelist_len, sizeof(char *), diralphasort);
 
 	    /* Make sure the selected file is within range. */
 	    if (selected >= filelist_len)
@@ -351,10 +382,15 @@ char *do_browser(char *path, DIR *dir)
     free(path);
     free(ans);
 
+    free_blurbs();
     free_chararray(filelist, filelist_len);
     filelist = NULL;
     filelist_len = 0;
 
+#ifdef USE_DIRWATCH
+    stop_watching_directory();
+#endif
+
     return retval;
 }
 
@@ -412,17 +448,64 @@ char *do_browse_from(const char *inpath)
     return do_browser(path, dir);
 }
 
-/* Set filelist to the list of files contained in the directory path,
- * set filelist_len to the number of files in that list, set longest to
- * the width in columns of the longest filename in that list (between 15
- * and COLS), and set width to the number of files that we can display
- * per line.  longest needs to be at least 15 columns in order to
- * display ".. (parent dir)", as Pico does.  Assume path exists and is a
- * directory. */
+/* Free the information kept about the files in the list.  This has to
+ * happen before the list itself is freed, so that the helper threads
+ * stop looking at the files first. */
+void free_blurbs(void)
+{
+    size_t i;
+
+#ifdef USE_PREFETCH
+    pthread_mutex_lock(&entries_lock);
+
+    /* Make the helpers leave the entries alone, and discard whatever
+     * they are still looking at. */
+    wanted_from = shown_from = wanted_to = 0;
+    patient_page = (size_t)-1;
+    generation++;
+#endif
+
+    for (i = 0; i < filelist_len && entries != NULL; i++)
+	free(entries[i].blurb);
+
+    free(entries);
+    entries = NULL;
+
+#ifdef USE_PREFETCH
+    pthread_mutex_unlock(&entries_lock);
+#endif
+}
+
+/* Our sort routine for the file list: like diralphasort(), but using
+ * what is already known about each file instead of asking for it at
+ * every comparison. */
+int browser_sort(const void *va, const void *vb)
+{
+    const browserentry *a = (const browserentry *)va;
+    const browserentry *b = (const browserentry *)vb;
+
+    if (a->isdir && !b->isdir)
+	return -1;
+    if (!a->isdir && b->isdir)
+	return 1;
+
+    return mbstrcasecmp(a->path, b->path);
+}
+
+/* Set filelist to the sorted list of files contained in the directory
+ * path, set filelist_len to the number of files in that list, set
+ * longest to the width in columns of the longest filename in that list
+ * (between 15 and COLS), and set width to the number of files that we
+ * can display per line.  longest needs to be at least 15 columns in
+ * order to display ".. (parent dir)", as Pico does.  Assume path exists
+ * and is a directory.  The directory is read only once, and a file is
+ * stat()ed only when the type that the directory gives for it doesn't
+ * tell whether it's a directory.  Changes in the directory are watched
+ * from before it is read, so that none get missed. */
 void browser_init(const char *path, DIR *dir)
 {
     const struct dirent *nextdir;
-    size_t i = 0, path_len = strlen(path);
+    size_t i = 0, size = 64, path_len = strlen(path);
     int col = 0;
 	/* The maximum number of columns that the filenames will take
 	 * up. */
@@ -436,16 +519,61 @@ void browser_init(const char *path, DIR *dir)
 
     longest = 0;
 
-    /* Find the length of the longest filename in the current folder. */
+    free_blurbs();
+    free_chararray(filelist, filelist_len);
+
+#ifdef USE_DIRWATCH
+    watch_directory(path);
+#endif
+
+    entries = (browserentry *)nmalloc(size * sizeof(browserentry));
+
     while ((nextdir = readdir(dir)) != NULL) {
-	size_t name_len = strlenpt(nextdir->d_name);
+	size_t name_len = strlen(nextdir->d_name);
+	size_t span = strlenpt(nextdir->d_name);
+	browserentry *entry;
+	struct stat st;
 
-	if (name_len > longest)
-	    longest = name_len;
+	/* Keep track of the length of the longest filename. */
+	if (span > longest)
+	    longest = span;
 
-	i++;
+	/* Don't show the "." entry. */
+	if (strcmp(nextdir->d_name, ".") == 0)
+	    continue;
+
+	if (i == size) {
+	    size *= 2;
+	    entries = (browserentry *)nrealloc(entries,
+			size * sizeof(browserentry));
+	}
+
+	entry = &entries[i++];
+
+	entry->path = charalloc(path_len + name_len + 1);
+	memcpy(entry->path, path, path_len);
+	memcpy(entry->path + path_len, nextdir->d_name, name_len + 1);
+	entry->blurb = NULL;
+	entry->fresh = FALSE;
+	entry->busy = FALSE;
+	entry->touched = FALSE;
+
+#ifdef _DIRENT_HAVE_D_TYPE
+	if (nextdir->d_type == DT_DIR)
+	    entry->isdir = TRUE;
+	else if (nextdir->d_type != DT_LNK &&
+		nextdir->d_type != DT_UNKNOWN)
+	    entry->isdir = FALSE;
+	else
+#endif
+	    entry->isdir = (stat(entry->path, &st) != -1 &&
+		S_ISDIR(st.st_mode));
     }
 
+    filelist_len = i;
+
+    closedir(dir);
+
     /* Put 10 characters' worth of blank space between columns of filenames
      * in the list whenever possible, as Pico does. */
     longest += 10;
@@ -456,33 +584,13 @@ void browser_init(const char *path, DIR *dir)
     if (longest > COLS)
 	longest = COLS;
 
-    rewinddir(dir);
-
-    free_chararray(filelist, filelist_len);
-
-    filelist_len = i;
+    /* Sort the list, directories first, and make it available by name. */
+    qsort(entries, filelist_len, sizeof(browserentry), browser_sort);
 
     filelist = (char **)nmalloc(filelist_len * sizeof(char *));
 
-    i = 0;
-
-    while ((nextdir = readdir(dir)) != NULL && i < filelist_len) {
-	/* Don't show the "." entry. */
-	if (strcmp(nextdir->d_name, ".") == 0)
-	    continue;
-
-	filelist[i] = charalloc(path_len + strlen(nextdir->d_name) + 1);
-	sprintf(filelist[i], "%s%s", path, nextdir->d_name);
-
-	i++;
-    }
-
-    /* Maybe the number of files in the directory changed between the
-     * first time we scanned and the second.  i is the actual length of
-     * filelist, so record it. */
-    filelist_len = i;
-
-    closedir(dir);
+    for (i = 0; i < filelist_len; i++)
+	filelist[i] = entries[i].path;
 
     /* Set width to zero, just before we initialize it. */
     width = 0;
@@ -544,6 +652,393 @@ functionptrtype parse_browser_input(int *kbinput)
     return func_from_key(kbinput);
 }
 
+/* Look at the file with the given path, and return the information to
+ * show about it: "--", "(dir)", "(parent dir)", or its size.  This may
+ * be called from a helper thread, so it must not touch any lists. */
+char *make_blurb(const char *path)
+{
+    struct stat st;
+    char *foo;
+    size_t foolen;
+    int foomaxlen = 7;
+	/* The maximum length of the file information in columns:
+	 * seven for "--", "(dir)", or the file size, and 12 for
+	 * "(parent dir)". */
+
+    /* We don't want to report file sizes for links, so we use
+     * lstat(). */
+    if (lstat(path, &st) == -1 || S_ISLNK(st.st_mode)) {
+	/* If the file doesn't exist (i.e. it's been deleted while
+	 * the file browser is open), or it's a symlink that doesn't
+	 * point to a directory, display "--". */
+	if (stat(path, &st) == -1 || !S_ISDIR(st.st_mode))
+	    foo = mallocstrcpy(NULL, "--");
+	/* If the file is a symlink that points to a directory,
+	 * display it as a directory. */
+	else
+	    /* TRANSLATORS: Try to keep this at most 7 characters. */
+	    foo = mallocstrcpy(NULL, _("(dir)"));
+    } else if (S_ISDIR(st.st_mode)) {
+	/* If the file is a directory, display it as such. */
+	if (strcmp(tail(path), "..") == 0) {
+	    /* TRANSLATORS: Try to keep this at most 12 characters. */
+	    foo = mallocstrcpy(NULL, _("(parent dir)"));
+	    foomaxlen = 12;
+	} else
+	    foo = mallocstrcpy(NULL, _("(dir)"));
+    } else {
+	off_t result = st.st_size;
+	char modifier;
+
+	foo = charalloc(foomaxlen + 1);
+
+	if (st.st_size < (1 << 10))
+	    modifier = ' ';  /* bytes */
+	else if (st.st_size < (1 << 20)) {
+	    result >>= 10;
+	    modifier = 'K';  /* kilobytes */
+	} else if (st.st_size < (1 << 30)) {
+	    result >>= 20;
+	    modifier = 'M';  /* megabytes */
+	} else {
+	    result >>= 30;
+	    modifier = 'G';  /* gigabytes */
+	}
+
+	/* Show the size if less than a terabyte,
+	 * otherwise show "(huge)". */
+	if (result < (1 << 10))
+	    sprintf(foo, "%4ju %cB", (intmax_t)result, modifier);
+	else
+	    /* TRANSLATORS: Try to keep this at most 7 characters.
+	     * If necessary, you can leave out the parentheses. */
+	    foo = mallocstrcpy(foo, _("(huge)"));
+    }
+
+    /* Make sure foo takes up no more than foomaxlen columns. */
+    foolen = strlenpt(foo);
+    if (foolen > foomaxlen)
+	null_at(&foo, actual_x(foo, foomaxlen));
+
+    return foo;
+}
+
+/* Return the information to show about the file at the given index of
+ * the list.  Only look it up the first time the file gets shown, or
+ * when it has changed since; otherwise it is taken from the entry of
+ * the file.  When helper threads do the looking, show what was known
+ * before, or a placeholder, until they have found the answer. */
+const char *file_blurb(size_t index)
+{
+    browserentry *entry = &entries[index];
+
+#ifdef USE_PREFETCH
+    if (helpers > 0 && !entry->fresh)
+	return (entry->blurb != NULL) ? entry->blurb : "...";
+#endif
+
+    if (!entry->fresh) {
+	free(entry->blurb);
+	entry->blurb = make_blurb(entry->path);
+	entry->fresh = TRUE;
+    }
+
+    return entry->blurb;
+}
+
+#ifdef USE_PREFETCH
+/* Return the index of the file that a helper should look at next: one
+ * on the screen if there are any left, then one on the next page, then
+ * one on the previous page.  Return (size_t)-1 when there is none. */
+size_t next_to_look_at(void)
+{
+    size_t i;
+
+    for (i = shown_from; i < wanted_to; i++)
+	if (!entries[i].fresh && !entries[i].busy)
+	    return i;
+
+    for (i = wanted_from; i < shown_from; i++)
+	if (!entries[i].fresh && !entries[i].busy)
+	    return i;
+
+    return (size_t)-1;
+}
+
+/* The body of a helper thread: wait until there are files to look at,
+ * look at them one by one without holding the lock, store the results
+ * in their entries (unless the list was thrown away meanwhile), and
+ * let the main thread know through the pipe. */
+void *look_at_files(void *dummy)
+{
+    pthread_mutex_lock(&entries_lock);
+
+    while (TRUE) {
+	size_t index = next_to_look_at(), started = generation;
+	char *path, *blurb;
+
+	if (index == (size_t)-1) {
+	    pthread_cond_wait(&files_wanted, &entries_lock);
+	    continue;
+	}
+
+	entries[index].busy = TRUE;
+	path = mallocstrcpy(NULL, entries[index].path);
+
+	pthread_mutex_unlock(&entries_lock);
+	blurb = make_blurb(path);
+	free(path);
+	pthread_mutex_lock(&entries_lock);
+
+	if (started != generation) {
+	    free(blurb);
+	    continue;
+	}
+
+	/* If the file changed while we looked, it needs another look. */
+	free(entries[index].blurb);
+	entries[index].blurb = blurb;
+	entries[index].fresh = !entries[index].touched;
+	entries[index].touched = FALSE;
+	entries[index].busy = FALSE;
+
+	pthread_cond_broadcast(&file_found);
+
+	if (!reported)
+	    reported = (write(report_fd, "", 1) == 1);
+    }
+
+    return NULL;
+}
+
+/* Start the threads that look up the files shown in the browser, and
+ * the pipe through which they report.  When this fails, files will be
+ * looked up on the spot instead. */
+void start_helpers(void)
+{
+    static bool tried = FALSE;
+    int report_pipe[2], n;
+    sigset_t all_signals, old_signals;
+    pthread_t thread;
+
+    if (tried)
+	return;
+    tried = TRUE;
+
+    if (pipe(report_pipe) == -1)
+	return;
+
+    for (n = 0; n < 2; n++) {
+	fcntl(report_pipe[n], F_SETFL,
+		fcntl(report_pipe[n], F_GETFL) | O_NONBLOCK);
+	fcntl(report_pipe[n], F_SETFD, FD_CLOEXEC);
+    }
+
+    /* Keep the signals for the main thread, so that they interrupt
+     * its waiting for a keystroke. */
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &old_signals);
+
+    for (n = 0; n < PREFETCH_THREADS; n++)
+	if (pthread_create(&thread, NULL, look_at_files, NULL) == 0) {
+	    pthread_detach(thread);
+	    helpers++;
+	}
+
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+
+    if (helpers == 0) {
+	close(report_pipe[0]);
+	close(report_pipe[1]);
+	return;
+    }
+
+    prefetch_fd = report_pipe[0];
+    report_fd = report_pipe[1];
+}
+
+/* Have the helpers look at the files from index from up to to, which
+ * are about to be shown, and at those on the pages around them.  When
+ * this page wasn't shown just before, give the helpers a moment to
+ * finish it, so that placeholders appear only for slow filesystems.
+ * The entries must be locked. */
+void prefetch_blurbs(size_t from, size_t to)
+{
+    size_t page = to - from, i = from;
+    struct timeval now;
+    struct timespec until;
+    long micros;
+
+    wanted_from = (from > page) ? from - page : 0;
+    shown_from = from;
+    wanted_to = (to + page < filelist_len) ? to + page : filelist_len;
+
+    pthread_cond_broadcast(&files_wanted);
+
+    if (from == patient_page)
+	return;
+
+    patient_page = from;
+
+    gettimeofday(&now, NULL);
+    micros = now.tv_usec + PREFETCH_PATIENCE * 1000L;
+    until.tv_sec = now.tv_sec + micros / 1000000;
+    until.tv_nsec = (micros % 1000000) * 1000;
+
+    while (i < to) {
+	if (entries[i].fresh)
+	    i++;
+	else if (pthread_cond_timedwait(&file_found, &entries_lock,
+		&until) == ETIMEDOUT)
+	    break;
+    }
+}
+
+/* Empty the pipe through which the helpers report, so that they will
+ * report again when they find something new. */
+void handle_prefetch_results(void)
+{
+    char bytes[64];
+
+    pthread_mutex_lock(&entries_lock);
+    reported = FALSE;
+    pthread_mutex_unlock(&entries_lock);
+
+    while (read(prefetch_fd, bytes, sizeof(bytes)) > 0)
+	;
+}
+#endif /* USE_PREFETCH */
+
+#ifdef USE_DIRWATCH
+/* Watch the directory with the given path, instead of the one that was
+ * watched before. */
+void watch_directory(const char *path)
+{
+    if (browser_watch_fd == -1)
+	browser_watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (browser_watch_fd == -1)
+	return;
+
+    if (browser_wd != -1)
+	inotify_rm_watch(browser_watch_fd, browser_wd);
+
+    browser_wd = inotify_add_watch(browser_watch_fd, path,
+				BROWSER_DIR_EVENTS);
+}
+
+/* Stop watching the browsed directory. */
+void stop_watching_directory(void)
+{
+    if (browser_watch_fd != -1)
+	close(browser_watch_fd);
+
+    browser_watch_fd = -1;
+    browser_wd = -1;
+}
+
+/* Return the index of the file with the given name in the list, or
+ * filelist_len when it isn't there.  Since the list is sorted, the
+ * name can be looked for among the directories and among the other
+ * files by bisection. */
+size_t find_entry(const char *name)
+{
+    browserentry key;
+    size_t result = filelist_len;
+    int isdir;
+
+    key.path = charalloc(strlen(path_save) + strlen(name) + 1);
+    sprintf(key.path, "%s%s", path_save, name);
+
+    for (isdir = 0; isdir < 2 && result == filelist_len; isdir++) {
+	size_t low = 0, high = filelist_len;
+
+	key.isdir = isdir;
+
+	while (low < high) {
+	    size_t middle = low + (high - low) / 2;
+
+	    if (browser_sort(&entries[middle], &key) < 0)
+		low = middle + 1;
+	    else
+		high = middle;
+	}
+
+	/* Names that differ only in case sort as equal. */
+	for (; low < filelist_len &&
+		browser_sort(&entries[low], &key) == 0; low++)
+	    if (strcmp(entries[low].path, key.path) == 0) {
+		result = low;
+		break;
+	    }
+    }
+
+    free(key.path);
+
+    return result;
+}
+
+/* Mark the file at the given index of the list as needing another look.
+ * The entries must be locked. */
+void invalidate_blurb(size_t index)
+{
+    entries[index].fresh = FALSE;
+
+    if (entries[index].busy)
+	entries[index].touched = TRUE;
+}
+
+/* Read the pending events of the browsed directory, and mark the files
+ * that they concern as needing another look.  Return TRUE if any file
+ * in the list did. */
+bool handle_browser_events(void)
+{
+    union {
+	struct inotify_event event;
+	char bytes[BUFSIZ];
+    } events;
+    bool changed = FALSE;
+    ssize_t got;
+    size_t i;
+
+#ifdef USE_PREFETCH
+    pthread_mutex_lock(&entries_lock);
+#endif
+
+    while ((got = read(browser_watch_fd, &events, sizeof(events))) > 0) {
+	char *p = events.bytes;
+
+	while (p < events.bytes + got) {
+	    struct inotify_event *event = (struct inotify_event *)p;
+
+	    if (event->mask & IN_Q_OVERFLOW) {
+		for (i = 0; i < filelist_len; i++)
+		    invalidate_blurb(i);
+		changed = TRUE;
+	    } else if (event->wd == browser_wd && event->len > 0) {
+		i = find_entry(event->name);
+		if (i < filelist_len) {
+		    invalidate_blurb(i);
+		    changed = TRUE;
+		}
+	    }
+
+	    p += sizeof(struct inotify_event) + event->len;
+	}
+    }
+
+#ifdef USE_PREFETCH
+    if (changed)
+	pthread_cond_broadcast(&files_wanted);
+
+    pthread_mutex_unlock(&entries_lock);
+#endif
+
+    return changed;
+}
+#endif /* USE_DIRWATCH */
+
+
 /* Set width to the number of files that we can display per line, if
  * necessary, and display the list of files. */
 void browser_refresh(void)
@@ -551,7 +1046,7 @@ void browser_refresh(void)
     size_t i;
     int line = 0, col = 0;
 	/* The current line and column while the list is getting displayed. */
-    char *foo;
+    const char *foo;
 	/* The additional information that we'll display about a file. */
 
     titlebar(path_save);
@@ -561,8 +1056,16 @@ void browser_refresh(void)
 
     i = width * editwinrows * ((selected / width) / editwinrows);
 
+#ifdef USE_PREFETCH
+    /* Keep the helpers from changing the entries while they are drawn. */
+    pthread_mutex_lock(&entries_lock);
+
+    if (helpers > 0)
+	prefetch_blurbs(i, (i + width * editwinrows < filelist_len) ?
+		i + width * editwinrows : filelist_len);
+#endif
+
     for (; i < filelist_len && line < editwinrows; i++) {
-	struct stat st;
 	const char *filetail = tail(filelist[i]);
 		/* The filename we display, minus the path. */
 	size_t filetaillen = strlenpt(filetail);
@@ -571,8 +1074,7 @@ void browser_refresh(void)
 		/* The length of the file information in columns. */
 	int foomaxlen = 7;
 		/* The maximum length of the file information in
-		 * columns: seven for "--", "(dir)", or the file size,
-		 * and 12 for "(parent dir)". */
+		 * columns: seven for "--", "(dir)", or the file size. */
 	bool dots = (COLS >= 15 && filetaillen >= longest - foomaxlen);
 		/* Do we put an ellipsis before the filename?  Don't set
 		 * this to TRUE if we have fewer than 15 columns (i.e.
@@ -600,62 +1102,9 @@ void browser_refresh(void)
 
 	col += longest;
 
-	/* Show information about the file.  We don't want to report
-	 * file sizes for links, so we use lstat(). */
-	if (lstat(filelist[i], &st) == -1 || S_ISLNK(st.st_mode)) {
-	    /* If the file doesn't exist (i.e. it's been deleted while
-	     * the file browser is open), or it's a symlink that doesn't
-	     * point to a directory, display "--". */
-	    if (stat(filelist[i], &st) == -1 || !S_ISDIR(st.st_mode))
-		foo = mallocstrcpy(NULL, "--");
-	    /* If the file is a symlink that points to a directory,
-	     * display it as a directory. */
-	    else
-		/* TRANSLATORS: Try to keep this at most 7 characters. */
-		foo = mallocstrcpy(NULL, _("(dir)"));
-	} else if (S_ISDIR(st.st_mode)) {
-	    /* If the file is a directory, display it as such. */
-	    if (strcmp(filetail, "..") == 0) {
-		/* TRANSLATORS: Try to keep this at most 12 characters. */
-		foo = mallocstrcpy(NULL, _("(parent dir)"));
-		foomaxlen = 12;
-	    } else
-		foo = mallocstrcpy(NULL, _("(dir)"));
-	} else {
-	    off_t result = st.st_size;
-	    char modifier;
-
-	    foo = charalloc(foomaxlen + 1);
-
-	    if (st.st_size < (1 << 10))
-		modifier = ' ';  /* bytes */
-	    else if (st.st_size < (1 << 20)) {
-		result >>= 10;
-		modifier = 'K';  /* kilobytes */
-	    } else if (st.st_size < (1 << 30)) {
-		result >>= 20;
-		modifier = 'M';  /* megabytes */
-	    } else {
-		result >>= 30;
-		modifier = 'G';  /* gigabytes */
-	    }
-
-	    /* Show the size if less than a terabyte,
-	     * otherwise show "(huge)". */
-	    if (result < (1 << 10))
-		sprintf(foo, "%4ju %cB", (intmax_t)result, modifier);
-	    else
-		/* TRANSLATORS: Try to keep this at most 7 characters.
-		 * If necessary, you can leave out the parentheses. */
-		foo = mallocstrcpy(foo, _("(huge)"));
-	}
-
-	/* Make sure foo takes up no more than foomaxlen columns. */
+	/* Show information about the file. */
+	foo = file_blurb(i);
 	foolen = strlenpt(foo);
-	if (foolen > foomaxlen) {
-	    null_at(&foo, actual_x(foo, foomaxlen));
-	    foolen = foomaxlen;
-	}
 
 	mvwaddstr(edit, line, col - foolen, foo);
 
@@ -663,8 +1112,6 @@ void browser_refresh(void)
 	if (i == selected)
 	    wattroff(edit, hilite_attribute);
 
-	free(foo);
-
 	/* Add some space between the columns. */
 	col += 2;
 
@@ -678,6 +1125,10 @@ void browser_refresh(void)
 	wmove(edit, line, col);
     }
 
+#ifdef USE_PREFETCH
+    pthread_mutex_unlock(&entries_lock);
+#endif
+
     wnoutrefresh(edit);
 }
 
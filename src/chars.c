@@ -34,6 +34,12 @@
 #include <wctype.h>
 #endif
 
+#if defined(__GNUC__) && (__GNUC__ >= 5 || defined(__clang__)) && \
+	(defined(__x86_64__) || defined(__i386__))
+#define USE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
 static bool use_utf8 = FALSE;
 	/* Whether we've enabled UTF-8 support. */
 static const wchar_t bad_wchar = 0xFFFD;
@@ -43,11 +49,369 @@ static const wchar_t bad_wchar = 0xFFFD;
 static const char *const bad_mbchar = "\xEF\xBF\xBD";
 static const int bad_mbchar_len = 3;
 
+static const unsigned char utf8_length[256] = {
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+    4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 0, 0
+};
+	/* The length of a UTF-8 sequence by its first byte, or zero
+	 * when that byte cannot begin one. */
+static const wchar_t utf8_minimum[7] = {
+    0, 0, 0x80, 0x800, 0x10000, 0x200000, 0x4000000
+};
+	/* The smallest value that a sequence of each length may encode;
+	 * anything below it is an overlong form. */
+
+#define INFO_WIDTH 0x03
+#define INFO_ALNUM 0x04
+#define INFO_PUNCT 0x08
+#define INFO_BLANK 0x10
+	/* The bits of what char_info() tells about a character. */
+#define INFO_BLOCKS (0x110000 >> 8)
+static unsigned char *char_table[INFO_BLOCKS];
+	/* What the locale says about each character, in blocks of 256
+	 * characters, each filled in when first needed. */
+#ifdef USE_THREADS
+static pthread_mutex_t char_table_lock = PTHREAD_MUTEX_INITIALIZER;
+	/* Guards the filling in of char_table. */
+#endif
+
+/* Return how many bytes from the start of s, at most len, form a run
+ * of whole ASCII characters, and add the number of characters in that
+ * run to *chars.  This is what every kernel below must do at least;
+ * they may vouch for more. */
+static size_t utf8_span_plain(const unsigned char *s, size_t len,
+	size_t *chars)
+{
+    size_t done = 0;
+
+    while (done < len && s[done] < 0x80)
+	done++;
+
+    *chars += done;
+
+    return done;
+}
+
+#ifdef USE_X86_KERNELS
+/* Do what utf8_span_plain() does, sixteen bytes at a time. */
+__attribute__((target("sse2")))
+static size_t utf8_span_sse2(const unsigned char *s, size_t len,
+	size_t *chars)
+{
+    size_t done = 0;
+
+    while (len - done >= 16) {
+	__m128i input = _mm_loadu_si128((const __m128i *)(s + done));
+
+	if (_mm_movemask_epi8(input) != 0)
+	    break;
+
+	done += 16;
+    }
+
+    *chars += done;
+
+    return done;
+}
+
+#define TOO_SHORT (1 << 0)
+#define TOO_LONG (1 << 1)
+#define OVERLONG_3 (1 << 2)
+#define TOO_LARGE (1 << 3)
+#define SURROGATE (1 << 4)
+#define OVERLONG_2 (1 << 5)
+#define TOO_LARGE_1000 (1 << 6)
+#define OVERLONG_4 (1 << 6)
+#define TWO_CONTS (1 << 7)
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+	/* The kinds of error that a pair of adjacent bytes can show, as
+	 * found by looking up the high and low nibble of the first byte
+	 * and the high nibble of the second byte. */
+
+/* Return how many bytes from the start of s, at most len, form a run of
+ * whole characters in valid UTF-8, thirty-two bytes at a time, and add
+ * the number of characters in that run to *chars.  Validation goes by
+ * the nibble lookups of Keiser and Lemire: every block is checked in
+ * the light of the last three bytes of the previous one, and the run
+ * ends before the first block with an error.  Five- and six-byte forms,
+ * which the C library accepts, count as errors here; the caller has to
+ * deal with them one at a time. */
+__attribute__((target("avx2")))
+static size_t utf8_span_avx2(const unsigned char *s, size_t len,
+	size_t *chars)
+{
+    const __m256i byte_1_high_table = _mm256_setr_epi8(
+	TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+	TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+	TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+	TOO_SHORT | OVERLONG_2, TOO_SHORT,
+	TOO_SHORT | OVERLONG_3 | SURROGATE,
+	TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+	TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+	TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+	TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+	TOO_SHORT | OVERLONG_2, TOO_SHORT,
+	TOO_SHORT | OVERLONG_3 | SURROGATE,
+	TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+    const __m256i byte_1_low_table = _mm256_setr_epi8(
+	CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+	CARRY | OVERLONG_2, CARRY, CARRY, CARRY | TOO_LARGE,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+	CARRY | OVERLONG_2, CARRY, CARRY, CARRY | TOO_LARGE,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+	CARRY | TOO_LARGE | TOO_LARGE_1000,
+	CARRY | TOO_LARGE | TOO_LARGE_1000);
+    const __m256i byte_2_high_table = _mm256_setr_epi8(
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 |
+		TOO_LARGE_1000 | OVERLONG_4,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 |
+		TOO_LARGE_1000 | OVERLONG_4,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+	TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+	TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i previous = _mm256_setzero_si256();
+    size_t done = 0, count = 0;
+
+    while (len - done >= 32) {
+	__m256i input = _mm256_loadu_si256((const __m256i *)(s + done));
+	__m256i shifted = _mm256_permute2x128_si256(previous, input, 0x21);
+	__m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+	__m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+	__m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+	__m256i special, must_continue, error;
+
+	special = _mm256_and_si256(_mm256_and_si256(
+		_mm256_shuffle_epi8(byte_1_high_table, _mm256_and_si256(
+			_mm256_srli_epi16(prev1, 4), nibble)),
+		_mm256_shuffle_epi8(byte_1_low_table,
+			_mm256_and_si256(prev1, nibble))),
+		_mm256_shuffle_epi8(byte_2_high_table, _mm256_and_si256(
+			_mm256_srli_epi16(input, 4), nibble)));
+
+	/* A byte must be a continuation when the byte two places back
+	 * begins a three-byte sequence or the byte three places back a
+	 * four-byte one; that must match the TWO_CONTS bit exactly. */
+	must_continue = _mm256_and_si256(_mm256_or_si256(
+		_mm256_subs_epu8(prev2, _mm256_set1_epi8(0x60)),
+		_mm256_subs_epu8(prev3, _mm256_set1_epi8(0x70))),
+		_mm256_set1_epi8((char)0x80));
+	error = _mm256_xor_si256(must_continue, special);
+
+	if (!_mm256_testz_si256(error, error))
+	    break;
+
+	/* Count the bytes that are not continuation bytes. */
+	count += __builtin_popcount((unsigned int)_mm256_movemask_epi8(
+		_mm256_cmpgt_epi8(input, _mm256_set1_epi8(-65))));
+
+	previous = input;
+	done += 32;
+    }
+
+    /* The last character of the run may need bytes that weren't
+     * checked, so leave it out. */
+    if (done > 0) {
+	size_t end = done;
+
+	while (end > done - 4 && (s[end - 1] & 0xC0) == 0x80)
+	    end--;
+	if (s[end - 1] >= 0xC0)
+	    end--;
+
+	if (end < done)
+	    count--;
+	done = end;
+    }
+
+    *chars += count;
+
+    return done;
+}
+#endif /* USE_X86_KERNELS */
+
+static size_t (*utf8_span)(const unsigned char *s, size_t len,
+	size_t *chars) = utf8_span_plain;
+	/* The fastest kernel that this processor can run. */
+
 /* Enable UTF-8 support. */
 void utf8_init(void)
 {
     use_utf8 = TRUE;
+
+#ifdef USE_X86_KERNELS
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+	utf8_span = utf8_span_avx2;
+    else if (__builtin_cpu_supports("sse2"))
+	utf8_span = utf8_span_sse2;
+#endif
+}
+
+/* Decode the UTF-8 sequence at the start of buf into wc, and return
+ * its length in bytes, or -1 if buf doesn't begin with a valid one.
+ * This accepts and rejects exactly what the C library's mbtowc() does
+ * in a UTF-8 locale, without its overhead or its shift state. */
+static int utf8_decode(const char *buf, wchar_t *wc)
+{
+    const unsigned char *s = (const unsigned char *)buf;
+    int length = utf8_length[*s], i;
+    wchar_t value;
+
+    if (length <= 1) {
+	*wc = *s;
+	return (length == 1) ? 1 : -1;
+    }
+
+    value = *s & (0x7F >> length);
+
+    for (i = 1; i < length; i++) {
+	if ((s[i] & 0xC0) != 0x80)
+	    return -1;
+	value = (value << 6) | (s[i] & 0x3F);
+    }
+
+    /* Reject overlong forms and UTF-16 surrogates. */
+    if (value < utf8_minimum[length] || (0xD800 <= value &&
+	value <= 0xDFFF))
+	return -1;
+
+    *wc = value;
+    return length;
+}
+
+/* Return the value of the multibyte character at c, or that of the
+ * Replacement Character if c doesn't begin with a valid one. */
+static wchar_t mbchar_value(const char *c)
+{
+    wchar_t wc;
+
+    if (utf8_decode(c, &wc) < 0)
+	wc = bad_wchar;
+
+    return wc;
+}
+
+/* Look up what the locale says about each of the 256 characters of the
+ * block with the given index. */
+static unsigned char *make_char_block(size_t index)
+{
+    unsigned char *block = (unsigned char *)nmalloc(256);
+    wchar_t first = index << 8;
+    int i;
+
+    for (i = 0; i < 256; i++) {
+	int width = wcwidth(first + i);
+
+	if (width < 0)
+	    width = wcwidth(bad_wchar);
+
+	block[i] = width & INFO_WIDTH;
+
+	if (iswalnum(first + i))
+	    block[i] |= INFO_ALNUM;
+	if (iswpunct(first + i))
+	    block[i] |= INFO_PUNCT;
+	if (iswblank(first + i))
+	    block[i] |= INFO_BLANK;
+    }
+
+    return block;
+}
+
+/* Return what the locale says about wc: its width in columns (with an
+ * unprintable character counting as the Replacement Character) and
+ * whether it's alphanumeric, punctuation or blank.  The block of 256
+ * characters that wc belongs to is looked up the first time any of
+ * them is asked about. */
+static unsigned char char_info(wchar_t wc)
+{
+    unsigned char *block;
+
+    if (wc < 0 || wc >= 0x110000)
+	return char_info(bad_wchar) & INFO_WIDTH;
+
+#ifdef USE_THREADS
+    /* Words may be counted in several threads at once, so publish a
+     * block only once it's complete, and make it only once. */
+    block = __atomic_load_n(&char_table[wc >> 8], __ATOMIC_ACQUIRE);
+
+    if (block == NULL) {
+	pthread_mutex_lock(&char_table_lock);
+
+	block = char_table[wc >> 8];
+
+	if (block == NULL) {
+	    block = make_char_block(wc >> 8);
+	    __atomic_store_n(&char_table[wc >> 8], block,
+		__ATOMIC_RELEASE);
+	}
+
+	pthread_mutex_unlock(&char_table_lock);
+    }
+#else
+    block = char_table[wc >> 8];
+
+    if (block == NULL)
+	block = char_table[wc >> 8] = make_char_block(wc >> 8);
+#endif
+
+    return block[wc & 0xFF];
+}
+
+#ifdef DEBUG
+/* Free the blocks of character information. */
+void free_char_table(void)
+{
+    size_t i;
+
+    for (i = 0; i < INFO_BLOCKS; i++)
+	free(char_table[i]);
 }
+#endif
 
 /* Is UTF-8 support enabled? */
 bool using_utf8(void)
@@ -107,16 +471,9 @@ bool is_alnum_mbchar(const char *c)
     assert(c != NULL);
 
 #ifdef ENABLE_UTF8
-    if (use_utf8) {
-	wchar_t wc;
-
-	if (mbtowc(&wc, c, MB_CUR_MAX) < 0) {
-	    mbtowc_reset();
-	    wc = bad_wchar;
-	}
-
-	return iswalnum(wc);
-    } else
+    if (use_utf8)
+	return (char_info(mbchar_value(c)) & INFO_ALNUM) != 0;
+    else
 #endif
 	return isalnum((unsigned char)*c);
 }
@@ -127,16 +484,9 @@ bool is_blank_mbchar(const char *c)
     assert(c != NULL);
 
 #ifdef ENABLE_UTF8
-    if (use_utf8) {
-	wchar_t wc;
-
-	if (mbtowc(&wc, c, MB_CUR_MAX) < 0) {
-	    mbtowc_reset();
-	    wc = bad_wchar;
-	}
-
-	return iswblank(wc);
-    } else
+    if (use_utf8)
+	return (char_info(mbchar_value(c)) & INFO_BLANK) != 0;
+    else
 #endif
 	return isblank((unsigned char)*c);
 }
@@ -174,16 +524,9 @@ bool is_cntrl_mbchar(const char *c)
     assert(c != NULL);
 
 #ifdef ENABLE_UTF8
-    if (use_utf8) {
-	wchar_t wc;
-
-	if (mbtowc(&wc, c, MB_CUR_MAX) < 0) {
-	    mbtowc_reset();
-	    wc = bad_wchar;
-	}
-
-	return is_cntrl_wchar(wc);
-    } else
+    if (use_utf8)
+	return is_cntrl_wchar(mbchar_value(c));
+    else
 #endif
 	return is_cntrl_char((unsigned char)*c);
 }
@@ -194,16 +537,9 @@ bool is_punct_mbchar(const char *c)
     assert(c != NULL);
 
 #ifdef ENABLE_UTF8
-    if (use_utf8) {
-	wchar_t wc;
-
-	if (mbtowc(&wc, c, MB_CUR_MAX) < 0) {
-	    mbtowc_reset();
-	    wc = bad_wchar;
-	}
-
-	return iswpunct(wc);
-    } else
+    if (use_utf8)
+	return (char_info(mbchar_value(c)) & INFO_PUNCT) != 0;
+    else
 #endif
 	return ispunct((unsigned char)*c);
 }
@@ -327,24 +663,9 @@ int mbwidth(const char *c)
     assert(c != NULL);
 
 #ifdef ENABLE_UTF8
-    if (use_utf8) {
-	wchar_t wc;
-	int width;
-
-	if (mbtowc(&wc, c, MB_CUR_MAX) < 0) {
-	    mbtowc_reset();
-	    wc = bad_wchar;
-	}
-
-	width = wcwidth(wc);
-
-	if (width == -1) {
-	    wc = bad_wchar;
-	    width = wcwidth(wc);
-	}
-
-	return width;
-    } else
+    if (use_utf8)
+	return char_info(mbchar_value(c)) & INFO_WIDTH;
+    else
 #endif
 	return 1;
 }
@@ -403,16 +724,17 @@ int parse_mbchar(const char *buf, char *chr, size_t *col)
 
 #ifdef ENABLE_UTF8
     if (use_utf8) {
-	/* Get the number of bytes in the multibyte character. */
-	buf_mb_len = mblen(buf, MB_CUR_MAX);
+	wchar_t wc;
+
+	/* Get the number of bytes in the multibyte character.  If buf
+	 * contains an invalid multibyte character, only interpret buf's
+	 * first byte. */
+	buf_mb_len = utf8_decode(buf, &wc);
 
-	/* If buf contains an invalid multibyte character, only
-	 * interpret buf's first byte. */
 	if (buf_mb_len < 0) {
-	    IGNORE_CALL_RESULT(mblen(NULL, 0));
 	    buf_mb_len = 1;
-	} else if (buf_mb_len == 0)
-	    buf_mb_len++;
+	    wc = bad_wchar;
+	}
 
 	/* Save the multibyte character in chr. */
 	if (chr != NULL) {
@@ -431,23 +753,13 @@ int parse_mbchar(const char *buf, char *chr, size_t *col)
 	    /* If we have a control character, get its width using one
 	     * column for the "^" that will be displayed in front of it,
 	     * and the width in columns of its visible equivalent as
-	     * returned by control_mbrep(). */
-	    else if (is_cntrl_mbchar(buf)) {
-		char *ctrl_buf_mb = charalloc(MB_CUR_MAX);
-		int ctrl_buf_mb_len;
-
-		(*col)++;
-
-		ctrl_buf_mb = control_mbrep(buf, ctrl_buf_mb,
-			&ctrl_buf_mb_len);
-
-		*col += mbwidth(ctrl_buf_mb);
-
-		free(ctrl_buf_mb);
+	     * returned by control_wrep(). */
+	    else if (is_cntrl_wchar(wc))
+		*col += 1 + (char_info(control_wrep(wc)) & INFO_WIDTH);
 	    /* If we have a normal character, get its width in columns
 	     * normally. */
-	    } else
-		*col += mbwidth(buf);
+	    else
+		*col += char_info(wc) & INFO_WIDTH;
 	}
     } else {
 #endif
@@ -751,10 +1063,54 @@ char *mbrevstrcasestr(const char *haystack, const char *needle, const
 }
 #endif /* !NANO_TINY */
 
+#ifdef ENABLE_UTF8
+/* Return the number of multibyte characters in s, counting them the way
+ * parse_mbchar() does.  If valid isn't NULL, store in it whether s is
+ * valid UTF-8 throughout.  Runs that the kernel vouches for are counted
+ * in bulk; in between, go a character at a time for a while. */
+static size_t utf8_count(const char *s, bool *valid)
+{
+    const unsigned char *text = (const unsigned char *)s;
+    size_t len = strlen(s), chars = 0;
+
+    if (valid != NULL)
+	*valid = TRUE;
+
+    while (len > 0) {
+	size_t done = utf8_span(text, len, &chars), stepped;
+
+	text += done;
+	len -= done;
+
+	for (stepped = 0; len > 0 && stepped < 64; chars++) {
+	    wchar_t wc;
+	    int step = utf8_decode((const char *)text, &wc);
+
+	    if (step < 0) {
+		if (valid != NULL)
+		    *valid = FALSE;
+		step = 1;
+	    }
+
+	    text += step;
+	    len -= step;
+	    stepped += step;
+	}
+    }
+
+    return chars;
+}
+#endif
+
 /* This function is equivalent to strlen() for multibyte strings. */
 size_t mbstrlen(const char *s)
 {
-    return mbstrnlen(s, (size_t)-1);
+#ifdef ENABLE_UTF8
+    if (use_utf8)
+	return utf8_count(s, NULL);
+    else
+#endif
+	return strlen(s);
 }
 
 #ifndef HAVE_STRNLEN
@@ -968,10 +1324,15 @@ bool is_valid_mbstring(const char *s)
 {
     assert(s != NULL);
 
-    return
 #ifdef ENABLE_UTF8
-	use_utf8 ? (mbstowcs(NULL, s, 0) != (size_t)-1) :
+    if (use_utf8) {
+	bool valid;
+
+	utf8_count(s, &valid);
+
+	return valid;
+    } else
 #endif
-	TRUE;
+	return TRUE;
 }
 #endif /* !DISABLE_NANORC */
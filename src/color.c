@@ -28,6 +28,10 @@
 #include <errno.h>
 #include <time.h>
 #include <unistd.h>
+#include <ctype.h>
+#ifdef DEBUG
+#include <sys/time.h>
+#endif
 
 #ifdef HAVE_MAGIC_H
 #include <magic.h>
@@ -35,6 +39,27 @@
 
 #ifndef DISABLE_COLOR
 
+static syntaxmatch *suffix_table = NULL;
+	/* The hash table of file extensions that select a syntax. */
+static size_t suffix_table_size = 0;
+	/* The number of slots in that table; a power of two. */
+static size_t suffix_count = 0;
+	/* The number of extensions in that table. */
+static syntaxmatch *general_matches = NULL;
+	/* The extension regexes that can't be reduced to extensions. */
+static size_t general_count = 0;
+	/* The number of those regexes. */
+static syntaxtype *default_syntax = NULL;
+	/* The syntax named "default", if any. */
+static bool syntax_index_built = FALSE;
+	/* Whether the above have been filled in yet. */
+#ifdef HAVE_LIBMAGIC
+static magic_t magic_cookie = NULL;
+	/* The handle on the loaded magic database. */
+static bool magic_failed = FALSE;
+	/* Whether loading that database failed. */
+#endif
+
 /* Initialize the colors for nano's interface, and assign pair numbers
  * for the colors in each syntax. */
 void set_colorpairs(void)
@@ -149,12 +174,357 @@ void nfreeregex(regex_t **r)
     *r = NULL;
 }
 
+/* Return TRUE when the given syntax-selecting regex matches text.  The
+ * regex normally got compiled when it was read in, but not when it came
+ * from the syntax cache; then it gets compiled now, once. */
+bool regex_matches(regexlisttype *e, const char *text)
+{
+    if (e->ext == NULL) {
+	e->ext = (regex_t *)nmalloc(sizeof(regex_t));
+	if (regcomp(e->ext, fixbounds(e->ext_regex),
+		REG_EXTENDED | REG_NOSUB) != 0) {
+	    free(e->ext);
+	    e->ext = NULL;
+	    return FALSE;
+	}
+    }
+
+    return (regexec(e->ext, text, 0, NULL, 0) == 0);
+}
+
+/* Expand the sequence of atoms at *r in a restricted regex into the set
+ * of strings that it matches, storing them in *set and their number in
+ * *count.  An atom is a word character, an escaped punctuation mark, a
+ * bracket expression of word characters and ranges, or a parenthesized
+ * group of alternatives, and may be followed by a question mark.  Stop
+ * at a bar, a closing parenthesis, or a dollar sign.  Return FALSE if
+ * the regex holds anything else, or if the set gets too large. */
+bool expand_sequence(const char **r, char ***set, size_t *count)
+{
+    *set = (char **)nmalloc(sizeof(char *));
+    (*set)[0] = mallocstrcpy(NULL, "");
+    *count = 1;
+
+    while (**r != '|' && **r != ')' && **r != '$') {
+	char **atoms = NULL, **product;
+	size_t atom_count = 0, i, j;
+	bool okay = TRUE;
+
+	if (**r == '(') {
+	    (*r)++;
+	    okay = expand_alternatives(r, &atoms, &atom_count);
+	    if (okay && **r == ')')
+		(*r)++;
+	    else
+		okay = FALSE;
+	} else if (**r == '[') {
+	    const char *p = *r + 1;
+
+	    while (okay && *p != ']') {
+		char first = *p, last = *p;
+
+		if (!is_word_byte(first))
+		    okay = FALSE;
+		else if (p[1] == '-' && is_word_byte(p[2]) && p[2] >= first) {
+		    last = p[2];
+		    p += 2;
+		}
+		p++;
+
+		for (; okay && first <= last; first++) {
+		    if (!is_word_byte(first))
+			continue;
+		    atoms = (char **)nrealloc(atoms, (atom_count + 1) *
+			sizeof(char *));
+		    atoms[atom_count] = charalloc(2);
+		    atoms[atom_count][0] = first;
+		    atoms[atom_count++][1] = '\0';
+		}
+	    }
+	    *r = (*p == ']') ? p + 1 : p;
+	} else if (is_word_byte(**r) || (**r == '\\' && (*r)[1] != '\0' &&
+		strchr(".+*?()[]{}|^$\\/", (*r)[1]) != NULL)) {
+	    if (**r == '\\')
+		(*r)++;
+	    atoms = (char **)nmalloc(sizeof(char *));
+	    atoms[0] = charalloc(2);
+	    atoms[0][0] = **r;
+	    atoms[0][1] = '\0';
+	    atom_count = 1;
+	    (*r)++;
+	} else
+	    okay = FALSE;
+
+	/* An optional atom may also match nothing. */
+	if (okay && **r == '?') {
+	    atoms = (char **)nrealloc(atoms, (atom_count + 1) *
+		sizeof(char *));
+	    atoms[atom_count++] = mallocstrcpy(NULL, "");
+	    (*r)++;
+	}
+
+	if (!okay || atom_count == 0 ||
+		*count * atom_count > MAX_EXPANDED_SUFFIXES) {
+	    for (i = 0; i < atom_count; i++)
+		free(atoms[i]);
+	    free(atoms);
+	    return FALSE;
+	}
+
+	/* Append each expansion of the atom to each string so far. */
+	product = (char **)nmalloc(*count * atom_count * sizeof(char *));
+	for (i = 0; i < *count; i++) {
+	    for (j = 0; j < atom_count; j++) {
+		char *both = charalloc(strlen((*set)[i]) +
+			strlen(atoms[j]) + 1);
+
+		sprintf(both, "%s%s", (*set)[i], atoms[j]);
+		product[i * atom_count + j] = both;
+	    }
+	    free((*set)[i]);
+	}
+	for (j = 0; j < atom_count; j++)
+	    free(atoms[j]);
+	free(atoms);
+	free(*set);
+
+	*set = product;
+	*count *= atom_count;
+    }
+
+    return TRUE;
+}
+
+/* Expand the alternatives at *r in a restricted regex into the set of
+ * strings that they match; see expand_sequence().  Return FALSE if they
+ * can't be expanded. */
+bool expand_alternatives(const char **r, char ***set, size_t *count)
+{
+    *set = NULL;
+    *count = 0;
+
+    while (TRUE) {
+	char **more;
+	size_t more_count, i;
+
+	if (!expand_sequence(r, &more, &more_count) ||
+		*count + more_count > MAX_EXPANDED_SUFFIXES) {
+	    for (i = 0; i < *count; i++)
+		free((*set)[i]);
+	    free(*set);
+	    *set = NULL;
+	    return FALSE;
+	}
+
+	*set = (char **)nrealloc(*set, (*count + more_count) *
+		sizeof(char *));
+	memcpy(*set + *count, more, more_count * sizeof(char *));
+	*count += more_count;
+	free(more);
+
+	if (**r != '|')
+	    return TRUE;
+	(*r)++;
+    }
+}
+
+/* Return TRUE if the given byte may occur literally in an extension. */
+bool is_word_byte(char c)
+{
+    return (isalnum((unsigned char)c) || c == '_' || c == '-' || c == '~');
+}
+
+/* If the given extension regex has the form "\.X$", where X matches
+ * nothing but a limited set of strings without dots or slashes, then it
+ * matches exactly those filenames whose final extension is in that set.
+ * In that case, return the set and store its size in count.  Otherwise,
+ * return NULL. */
+char **regex_to_suffixes(const char *regex, size_t *count)
+{
+    const char *r = regex;
+    char **set;
+    size_t i;
+
+    if (strncmp(r, "\\.", 2) != 0)
+	return NULL;
+    r += 2;
+
+    if (!expand_alternatives(&r, &set, count))
+	return NULL;
+
+    if (strcmp(r, "$") == 0) {
+	for (i = 0; i < *count; i++)
+	    if (set[i][0] == '\0' || strpbrk(set[i], "./") != NULL)
+		break;
+	if (i == *count)
+	    return set;
+    }
+
+    for (i = 0; i < *count; i++)
+	free(set[i]);
+    free(set);
+
+    return NULL;
+}
+
+/* Return the slot in the extension table for the given extension. */
+size_t suffix_hash(const char *suffix)
+{
+    size_t hash = 5381;
+
+    for (; *suffix != '\0'; suffix++)
+	hash = hash * 33 + (unsigned char)*suffix;
+
+    return hash & (suffix_table_size - 1);
+}
+
+/* Build the index for choosing a syntax by filename.  The extension
+ * regexes that simply list extensions go into a hash table keyed on the
+ * extension, holding the last syntax that lists it.  The others are
+ * kept in a list, in order.  Also note which syntax is the default. */
+void build_syntax_index(void)
+{
+    syntaxtype *sint;
+    regexlisttype *e;
+    size_t rank = 0, i;
+
+    syntax_index_built = TRUE;
+
+    suffix_table_size = 64;
+    suffix_table = (syntaxmatch *)nmalloc(suffix_table_size *
+	sizeof(syntaxmatch));
+    memset(suffix_table, 0, suffix_table_size * sizeof(syntaxmatch));
+
+    for (sint = syntaxes; sint != NULL; sint = sint->next, rank++) {
+	if (strcmp(sint->desc, "default") == 0) {
+	    default_syntax = sint;
+	    continue;
+	}
+
+	for (e = sint->extensions; e != NULL; e = e->next) {
+	    size_t count;
+	    char **suffixes = regex_to_suffixes(e->ext_regex, &count);
+
+	    if (suffixes == NULL) {
+		general_matches = (syntaxmatch *)nrealloc(general_matches,
+			(general_count + 1) * sizeof(syntaxmatch));
+		general_matches[general_count].suffix = NULL;
+		general_matches[general_count].regex = e;
+		general_matches[general_count].syntax = sint;
+		general_matches[general_count++].rank = rank;
+		continue;
+	    }
+
+	    for (i = 0; i < count; i++) {
+		syntaxmatch *slot;
+
+		/* Keep the table at most half full. */
+		if (suffix_count * 2 >= suffix_table_size)
+		    grow_suffix_table();
+
+		slot = &suffix_table[suffix_hash(suffixes[i])];
+		while (slot->suffix != NULL && strcmp(slot->suffix,
+			suffixes[i]) != 0) {
+		    if (++slot == suffix_table + suffix_table_size)
+			slot = suffix_table;
+		}
+
+		if (slot->suffix == NULL) {
+		    slot->suffix = suffixes[i];
+		    suffix_count++;
+		} else
+		    free(suffixes[i]);
+
+		/* A later syntax overrides an earlier one. */
+		slot->regex = e;
+		slot->syntax = sint;
+		slot->rank = rank;
+	    }
+
+	    free(suffixes);
+	}
+    }
+
+#ifdef DEBUG
+    fprintf(stderr, "Indexed %lu extensions; %lu extension regexes are general\n",
+	(unsigned long)suffix_count, (unsigned long)general_count);
+#endif
+}
+
+/* Double the size of the extension table. */
+void grow_suffix_table(void)
+{
+    syntaxmatch *old_table = suffix_table;
+    size_t old_size = suffix_table_size, i;
+
+    suffix_table_size *= 2;
+    suffix_table = (syntaxmatch *)nmalloc(suffix_table_size *
+	sizeof(syntaxmatch));
+    memset(suffix_table, 0, suffix_table_size * sizeof(syntaxmatch));
+
+    for (i = 0; i < old_size; i++) {
+	syntaxmatch *slot;
+
+	if (old_table[i].suffix == NULL)
+	    continue;
+
+	slot = &suffix_table[suffix_hash(old_table[i].suffix)];
+	while (slot->suffix != NULL) {
+	    if (++slot == suffix_table + suffix_table_size)
+		slot = suffix_table;
+	}
+	*slot = old_table[i];
+    }
+
+    free(old_table);
+}
+
+/* Return the syntax whose extension regexes match the given canonical
+ * filename, or NULL if there is none.  When several syntaxes match, the
+ * last one wins.  Normally this takes a single probe of the extension
+ * table, plus trying those general regexes that belong to syntaxes that
+ * come later in the list than the one found. */
+syntaxtype *syntax_for_filename(const char *fullname)
+{
+    const char *base = strrchr(fullname, '/'), *dot;
+    syntaxmatch *found = NULL;
+    size_t i;
+
+    if (!syntax_index_built)
+	build_syntax_index();
+
+    base = (base == NULL) ? fullname : base + 1;
+    dot = strrchr(base, '.');
+
+    if (dot != NULL) {
+	syntaxmatch *slot = &suffix_table[suffix_hash(dot + 1)];
+
+	while (slot->suffix != NULL) {
+	    if (strcmp(slot->suffix, dot + 1) == 0) {
+		found = slot;
+		break;
+	    }
+	    if (++slot == suffix_table + suffix_table_size)
+		slot = suffix_table;
+	}
+    }
+
+    for (i = general_count; i > 0; i--) {
+	syntaxmatch *general = &general_matches[i - 1];
+
+	if (found != NULL && general->rank <= found->rank)
+	    break;
+	if (regex_matches(general->regex, fullname))
+	    return general->syntax;
+    }
+
+    return (found != NULL) ? found->syntax : NULL;
+}
+
 /* Update the color information based on the current filename. */
 void color_update(void)
 {
     syntaxtype *tmpsyntax;
-    syntaxtype *defsyntax = NULL;
-    colortype *tmpcolor, *defcolor = NULL;
     regexlisttype *e;
 
     assert(openfile != NULL);
@@ -192,59 +562,18 @@ void color_update(void)
      * there was no syntax by that name, get the syntax based on the
      * file extension, then try the headerline, and then try magic. */
     if (openfile->colorstrings == NULL) {
-	char *currentdir = getcwd(NULL, PATH_MAX + 1);
-	char *joinednames = charalloc(PATH_MAX + 1);
-	char *fullname = NULL;
-
-	if (currentdir != NULL) {
-	    /* Concatenate the current working directory with the
-	     * specified filename, and canonicalize the result. */
-	    sprintf(joinednames, "%s/%s", currentdir, openfile->filename);
-	    fullname = realpath(joinednames, NULL);
-	    free(currentdir);
-	}
+	/* Canonicalize the filename, relative to the current directory. */
+	char *fullname = realpath(openfile->filename, NULL);
 
 	if (fullname == NULL)
 	    fullname = mallocstrcpy(fullname, openfile->filename);
 
-	for (tmpsyntax = syntaxes; tmpsyntax != NULL;
-		tmpsyntax = tmpsyntax->next) {
-
-	    /* If this is the default syntax, it has no associated
-	     * extensions, which we've checked for elsewhere.  Skip over
-	     * it here, but keep track of its color regexes. */
-	    if (strcmp(tmpsyntax->desc, "default") == 0) {
-		defsyntax = tmpsyntax;
-		defcolor = tmpsyntax->color;
-		continue;
-	    }
-
-	    for (e = tmpsyntax->extensions; e != NULL; e = e->next) {
-		bool not_compiled = (e->ext == NULL);
-
-		/* e->ext_regex has already been checked for validity
-		 * elsewhere.  Compile its specified regex if we haven't
-		 * already. */
-		if (not_compiled) {
-		    e->ext = (regex_t *)nmalloc(sizeof(regex_t));
-		    regcomp(e->ext, fixbounds(e->ext_regex), REG_EXTENDED);
-		}
-
-		/* Set colorstrings if we match the extension regex. */
-		if (regexec(e->ext, fullname, 0, NULL, 0) == 0) {
-		    openfile->syntax = tmpsyntax;
-		    openfile->colorstrings = tmpsyntax->color;
-		    break;
-		}
-
-		/* Decompile e->ext_regex's specified regex if we aren't
-		 * going to use it. */
-		if (not_compiled)
-		    nfreeregex(&e->ext);
-	    }
+	tmpsyntax = syntax_for_filename(fullname);
+	if (tmpsyntax != NULL) {
+	    openfile->syntax = tmpsyntax;
+	    openfile->colorstrings = tmpsyntax->color;
 	}
 
-	free(joinednames);
 	free(fullname);
 
 	/* Check the headerline if the extension didn't match anything. */
@@ -256,25 +585,16 @@ void color_update(void)
 		tmpsyntax = tmpsyntax->next) {
 
 		for (e = tmpsyntax->headers; e != NULL; e = e->next) {
-		    bool not_compiled = (e->ext == NULL);
-
-		    if (not_compiled) {
-			e->ext = (regex_t *)nmalloc(sizeof(regex_t));
-			regcomp(e->ext, fixbounds(e->ext_regex), REG_EXTENDED);
-		    }
 #ifdef DEBUG
 		    fprintf(stderr, "Comparing header regex \"%s\" to fileage \"%s\"...\n",
 				    e->ext_regex, openfile->fileage->data);
 #endif
 		    /* Set colorstrings if we match the header-line regex. */
-		    if (regexec(e->ext, openfile->fileage->data, 0, NULL, 0) == 0) {
+		    if (regex_matches(e, openfile->fileage->data)) {
 			openfile->syntax = tmpsyntax;
 			openfile->colorstrings = tmpsyntax->color;
 			break;
 		    }
-
-		    if (not_compiled)
-			nfreeregex(&e->ext);
 		}
 	    }
 	}
@@ -283,30 +603,38 @@ void color_update(void)
 	/* Check magic if we don't have an answer yet. */
 	if (openfile->colorstrings == NULL) {
 	    struct stat fileinfo;
-	    magic_t cookie = NULL;
 	    const char *magicstring = NULL;
 #ifdef DEBUG
 	    fprintf(stderr, "No result from headerline either, trying libmagic...\n");
 #endif
-	    if (stat(openfile->filename, &fileinfo) == 0) {
-		/* Open the magic database and get a diagnosis of the file. */
-		cookie = magic_open(MAGIC_SYMLINK |
+	    /* Open and load the magic database only once, the first time
+	     * it is needed, and keep it for later files. */
+	    if (magic_cookie == NULL && !magic_failed &&
+			stat(openfile->filename, &fileinfo) == 0) {
+		magic_cookie = magic_open(MAGIC_SYMLINK |
 #ifdef DEBUG
 				    MAGIC_DEBUG | MAGIC_CHECK |
 #endif
 				    MAGIC_ERROR);
-		if (cookie == NULL || magic_load(cookie, NULL) < 0)
+		if (magic_cookie == NULL || magic_load(magic_cookie, NULL) < 0) {
 		    statusbar(_("magic_load() failed: %s"), strerror(errno));
-		else {
-		    magicstring = magic_file(cookie, openfile->filename);
-		    if (magicstring == NULL) {
-			statusbar(_("magic_file(%s) failed: %s"),
-					openfile->filename, magic_error(cookie));
-		    }
+		    if (magic_cookie != NULL)
+			magic_close(magic_cookie);
+		    magic_cookie = NULL;
+		    magic_failed = TRUE;
+		}
+	    }
+
+	    /* Get a diagnosis of the file. */
+	    if (magic_cookie != NULL && stat(openfile->filename, &fileinfo) == 0) {
+		magicstring = magic_file(magic_cookie, openfile->filename);
+		if (magicstring == NULL) {
+		    statusbar(_("magic_file(%s) failed: %s"),
+				openfile->filename, magic_error(magic_cookie));
+		}
 #ifdef DEBUG
-		    fprintf(stderr, "Returned magic string is: %s\n", magicstring);
+		fprintf(stderr, "Returned magic string is: %s\n", magicstring);
 #endif
-		}
 	    }
 
 	    /* Now try and find a syntax that matches the magicstring. */
@@ -314,58 +642,109 @@ void color_update(void)
 		tmpsyntax = tmpsyntax->next) {
 
 		for (e = tmpsyntax->magics; e != NULL; e = e->next) {
-		    bool not_compiled = (e->ext == NULL);
-
-		    if (not_compiled) {
-			e->ext = (regex_t *)nmalloc(sizeof(regex_t));
-			regcomp(e->ext, fixbounds(e->ext_regex), REG_EXTENDED);
-		    }
 #ifdef DEBUG
 		    fprintf(stderr, "Matching regex \"%s\" against \"%s\"\n", e->ext_regex, magicstring);
 #endif
 		    /* Set colorstrings if we match the magic-string regex. */
-		    if (magicstring && regexec(e->ext, magicstring, 0, NULL, 0) == 0) {
+		    if (magicstring && regex_matches(e, magicstring)) {
 			openfile->syntax = tmpsyntax;
 			openfile->colorstrings = tmpsyntax->color;
 			break;
 		    }
-
-		    if (not_compiled)
-			nfreeregex(&e->ext);
 		}
 		if (openfile->syntax != NULL)
 		    break;
 	    }
-	    if (stat(openfile->filename, &fileinfo) == 0)
-		magic_close(cookie);
 	}
 #endif /* HAVE_LIBMAGIC */
     }
 
     /* If we didn't find any syntax yet, and we do have a default one,
      * use it. */
-    if (openfile->colorstrings == NULL && defcolor != NULL) {
-	openfile->syntax = defsyntax;
-	openfile->colorstrings = defcolor;
+    if (openfile->colorstrings == NULL && default_syntax != NULL &&
+		default_syntax->color != NULL) {
+	openfile->syntax = default_syntax;
+	openfile->colorstrings = default_syntax->color;
+    }
+
+    if (openfile->syntax != NULL)
+	compile_syntax_colors(openfile->syntax);
+
+    openfile->colorstrings = (openfile->syntax != NULL) ?
+		openfile->syntax->color : NULL;
+}
+
+/* Compile the given regex of a color rule, and return it if it's valid.
+ * Otherwise, complain on the statusbar and return NULL. */
+regex_t *compile_color_regex(const char *regex, bool icase)
+{
+    regex_t *preg = (regex_t *)nmalloc(sizeof(regex_t));
+    const char *r = fixbounds(regex);
+    int rc = regcomp(preg, r, REG_EXTENDED | (icase ? REG_ICASE : 0));
+
+    if (rc != 0) {
+	size_t len = regerror(rc, preg, NULL, 0);
+	char *str = charalloc(len);
+
+	regerror(rc, preg, str, len);
+	statusbar(_("Bad regex \"%s\": %s"), r, str);
+	free(str);
+	free(preg);
+	return NULL;
     }
 
-    for (tmpcolor = openfile->colorstrings; tmpcolor != NULL;
-	tmpcolor = tmpcolor->next) {
-	/* tmpcolor->start_regex and tmpcolor->end_regex have already
-	 * been checked for validity elsewhere.  Compile their specified
-	 * regexes if we haven't already. */
+    return preg;
+}
+
+/* Compile the color regexes of the given syntax, if this hasn't been
+ * done yet: they get compiled only when a file first needs them, so
+ * that the many syntaxes that are read in but never used cost nothing
+ * beyond their parsing.  A rule with a bad regex gets dropped. */
+void compile_syntax_colors(syntaxtype *sint)
+{
+    colortype **link = &sint->color, *tmpcolor;
+#ifdef DEBUG
+    struct timeval before, after;
+    size_t count = 0;
+
+    gettimeofday(&before, NULL);
+#endif
+
+    while ((tmpcolor = *link) != NULL) {
 	if (tmpcolor->start == NULL) {
-	    tmpcolor->start = (regex_t *)nmalloc(sizeof(regex_t));
-	    regcomp(tmpcolor->start, fixbounds(tmpcolor->start_regex),
-		REG_EXTENDED | (tmpcolor->icase ? REG_ICASE : 0));
+	    tmpcolor->start = compile_color_regex(tmpcolor->start_regex,
+		tmpcolor->icase);
+
+	    if (tmpcolor->start != NULL && tmpcolor->end_regex != NULL) {
+		tmpcolor->end = compile_color_regex(tmpcolor->end_regex,
+			tmpcolor->icase);
+		if (tmpcolor->end == NULL)
+		    nfreeregex(&tmpcolor->start);
+	    }
+#ifdef DEBUG
+	    count++;
+#endif
 	}
 
-	if (tmpcolor->end_regex != NULL && tmpcolor->end == NULL) {
-	    tmpcolor->end = (regex_t *)nmalloc(sizeof(regex_t));
-	    regcomp(tmpcolor->end, fixbounds(tmpcolor->end_regex),
-		REG_EXTENDED | (tmpcolor->icase ? REG_ICASE : 0));
-	}
+	/* A rule that doesn't have a compiled regex by now is bad. */
+	if (tmpcolor->start == NULL) {
+	    *link = tmpcolor->next;
+	    free(tmpcolor->start_regex);
+	    free(tmpcolor->end_regex);
+	    free(tmpcolor);
+	} else
+	    link = &tmpcolor->next;
     }
+
+#ifdef DEBUG
+    if (count > 0) {
+	gettimeofday(&after, NULL);
+	fprintf(stderr, "Compiled %lu color rules of syntax \"%s\" in %ld microseconds\n",
+		(unsigned long)count, sint->desc,
+		(long)(after.tv_sec - before.tv_sec) * 1000000 +
+		(long)(after.tv_usec - before.tv_usec));
+    }
+#endif
 }
 
 /* Reset the multiline coloring cache for one specific regex (given by
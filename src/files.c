@@ -32,6 +32,13 @@
 #include <ctype.h>
 #include <pwd.h>
 #include <libgen.h>
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+#ifdef HAVE_LINUX_FS_H
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
 
 /* Verify that the containing directory of the given filename exists. */
 bool has_valid_path(const char *filename)
@@ -117,6 +124,9 @@ void make_new_buffer(void)
     openfile->current_stat = NULL;
     openfile->lock_filename = NULL;
 #endif
+#ifndef DISABLE_FOLLOW
+    openfile->follow = NULL;
+#endif
 #ifndef DISABLE_COLOR
     openfile->syntax = NULL;
     openfile->colorstrings = NULL;
@@ -143,6 +153,11 @@ void initialize_buffer_text(void)
  * update the titlebar to display the file's new status. */
 void set_modified(void)
 {
+#ifndef NANO_TINY
+    /* Whatever was changed, the indexes of long lines may be stale. */
+    edit_stamp++;
+#endif
+
     if (openfile->modified)
 	return;
 
@@ -482,6 +497,14 @@ bool open_buffer(const char *filename, bool undoable)
     /* If we have a non-new file, read it in.  Then, if the buffer has
      * no stat, update the stat, if applicable. */
     if (rc > 0) {
+#ifndef DISABLE_FOLLOW
+	/* A followed file is read through its own descriptor, so that
+	 * later additions can be read from where the reading stopped. */
+	if (ISSET(FOLLOW_MODE) && new_buffer) {
+	    fclose(f);
+	    start_following();
+	} else
+#endif
 	read_file(f, rc, filename, undoable, new_buffer);
 #ifndef NANO_TINY
 	if (openfile->current_stat == NULL)
@@ -696,6 +719,10 @@ filestruct *read_line(char *buf, size_t buf_len, filestruct *prevnode)
 #ifndef DISABLE_COLOR
     freshline->multidata = NULL;
 #endif
+#ifndef NANO_TINY
+    freshline->width = (size_t)-1;
+    freshline->chunks = NULL;
+#endif
 
     freshline->prev = prevnode;
 
@@ -984,6 +1011,595 @@ void read_file(FILE *f, int fd, const char *filename, bool undoable, bool checkw
 #endif
 }
 
+/* When the cursor or the mark of buffer sits beyond x in line, move it
+ * along with the text there, which now begins at to_x in line to. */
+void move_along(openfilestruct *buffer, filestruct *line, size_t x,
+	filestruct *to, size_t to_x)
+{
+    if (buffer->current == line && buffer->current_x > x) {
+	buffer->current = to;
+	buffer->current_x = buffer->current_x - x + to_x;
+    }
+#ifndef NANO_TINY
+    if (buffer->mark_begin == line && buffer->mark_begin_x > x) {
+	buffer->mark_begin = to;
+	buffer->mark_begin_x = buffer->mark_begin_x - x + to_x;
+    }
+#endif
+}
+
+/* Add the given line of len bytes to the buffer of feed, at its spot:
+ * just before the spot's line when the spot is at the start of it, and
+ * otherwise after the text before the spot, whereupon the rest of the
+ * line moves to a line of its own that becomes the spot. */
+void feed_line(feedstruct *feed, char *line, size_t len)
+{
+    openfilestruct *buffer = feed->buffer;
+    filestruct *bot = (feed->spot != NULL) ? feed->spot : buffer->filebot;
+    filestruct *freshline;
+
+    /* Convert nulls to newlines.  len is the string's real length. */
+    line[len] = '\0';
+    unsunder(line, len);
+
+#ifndef NANO_TINY
+    /* If it's a DOS line ("\r\n"), and file conversion isn't disabled,
+     * strip the '\r' part from the data. */
+    if (!ISSET(NO_CONVERT) && len > 0 && line[len - 1] == '\r')
+	line[--len] = '\0';
+#endif
+
+    buffer->totsize += mbstrlen(line) + 1;
+    feed->lines++;
+
+    if (feed->spot_x > 0) {
+	freshline = make_new_node(bot);
+	freshline->data = mallocstrcpy(NULL, bot->data + feed->spot_x);
+	freshline->next = bot->next;
+
+	if (bot->next != NULL)
+	    bot->next->prev = freshline;
+	else
+	    buffer->filebot = freshline;
+	bot->next = freshline;
+
+	move_along(buffer, bot, feed->spot_x, freshline, 0);
+
+	bot->data = charealloc(bot->data, feed->spot_x + len + 1);
+	strcpy(bot->data + feed->spot_x, line);
+#ifndef NANO_TINY
+	edit_stamp++;
+#endif
+	feed->spot = freshline;
+	feed->spot_x = 0;
+	return;
+    }
+
+    freshline = make_new_node(bot->prev);
+    freshline->data = mallocstrcpy(NULL, line);
+
+    freshline->next = bot;
+    bot->prev = freshline;
+    bot->lineno = freshline->lineno + 1;
+
+    if (freshline->prev != NULL)
+	freshline->prev->next = freshline;
+    else {
+	buffer->fileage = freshline;
+
+	/* When the first line arrives and the user hasn't moved away
+	 * from the start of the buffer, let the view stay there. */
+	if (feed->keep_top) {
+	    if (buffer->edittop == bot)
+		buffer->edittop = freshline;
+	    if (buffer->current == bot) {
+		buffer->current = freshline;
+		buffer->current_x = 0;
+		buffer->placewewant = 0;
+	    }
+	}
+    }
+}
+
+/* Split the count bytes at chunk into lines, in the same way as
+ * read_file() does, and add every complete line to the buffer of feed.
+ * An incomplete line is kept in feed until the rest of it arrives. */
+void feed_text(feedstruct *feed, const char *chunk, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+	char input = chunk[i];
+
+	/* When carriage returns don't matter (anymore), copy everything
+	 * up to the next newline in one go. */
+#ifndef NANO_TINY
+	if (ISSET(NO_CONVERT) || (feed->lines > 0 && feed->format == 0))
+#endif
+	{
+	    const char *newline = memchr(chunk + i, '\n', count - i);
+	    size_t span = (newline == NULL ? count : newline - chunk) - i;
+
+	    if (feed->len + span + 2 > feed->size) {
+		while (feed->len + span + 2 > feed->size)
+		    feed->size += MAX_BUF_SIZE + feed->len;
+		feed->line = charealloc(feed->line, feed->size);
+	    }
+
+	    memcpy(feed->line + feed->len, chunk + i, span);
+	    feed->len += span;
+	    i += span;
+
+	    if (newline == NULL)
+		break;
+
+	    feed_line(feed, feed->line, feed->len);
+	    feed->len = 0;
+	    continue;
+	}
+
+	/* Make room for the byte plus a terminating null. */
+	if (feed->len + 2 > feed->size) {
+	    feed->size += MAX_BUF_SIZE + feed->len;
+	    feed->line = charealloc(feed->line, feed->size);
+	}
+
+	if (input == '\n') {
+#ifndef NANO_TINY
+	    /* If it's a DOS file or a DOS/Mac file ('\r' before '\n' on
+	     * the first line if we think it's a *nix file, or on any
+	     * line otherwise), and file conversion isn't disabled,
+	     * handle it! */
+	    if (!ISSET(NO_CONVERT) && (feed->lines == 0 ||
+			feed->format != 0) && feed->len > 0 &&
+			feed->line[feed->len - 1] == '\r') {
+		if (feed->format == 0 || feed->format == 2)
+		    feed->format++;
+	    }
+#endif
+	    feed_line(feed, feed->line, feed->len);
+	    feed->len = 0;
+#ifndef NANO_TINY
+	/* If it's a Mac file ('\r' without '\n' on the first line if we
+	 * think it's a *nix file, or on any line otherwise), and file
+	 * conversion isn't disabled, handle it! */
+	} else if (!ISSET(NO_CONVERT) && (feed->lines == 0 ||
+		feed->format != 0) && feed->len > 0 &&
+		feed->line[feed->len - 1] == '\r') {
+	    if (feed->format == 0 || feed->format == 1)
+		feed->format += 2;
+
+	    feed_line(feed, feed->line, feed->len);
+	    feed->line[0] = input;
+	    feed->len = 1;
+#endif
+	} else
+	    feed->line[feed->len++] = input;
+    }
+}
+
+/* Put the incomplete line of feed into its buffer at the spot, as
+ * read_file() does with an unterminated last line, and end it with a
+ * line break (a new magicline, at the end of the buffer) if it had
+ * text, unless the lines go into the middle of the file.  Then discard
+ * the incomplete line, and leave the spot just after what was added.
+ * Return TRUE if a line break was added. */
+bool finish_feed(feedstruct *feed)
+{
+    bool added_magicline = FALSE;
+    openfilestruct *buffer = feed->buffer;
+    filestruct *bot = (feed->spot != NULL) ? feed->spot : buffer->filebot;
+    size_t x = feed->spot_x, added = 0;
+
+    if (feed->len > 0) {
+	size_t bot_len = strlen(bot->data);
+
+#ifndef NANO_TINY
+	if (!ISSET(NO_CONVERT) && feed->line[feed->len - 1] == '\r' &&
+		(feed->format == 0 || feed->format == 1))
+	    feed->format += 2;
+#endif
+	feed->line[feed->len] = '\0';
+	unsunder(feed->line, feed->len);
+
+#ifndef NANO_TINY
+	if (!ISSET(NO_CONVERT) && feed->line[feed->len - 1] == '\r')
+	    feed->line[--feed->len] = '\0';
+#endif
+	bot->data = charealloc(bot->data, feed->len + bot_len + 1);
+	charmove(bot->data + x + feed->len, bot->data + x, bot_len - x + 1);
+#ifndef NANO_TINY
+	edit_stamp++;
+#endif
+	strncpy(bot->data + x, feed->line, feed->len);
+	buffer->totsize += mbstrlen(feed->line);
+	feed->lines++;
+
+	move_along(buffer, bot, x, bot, x + feed->len);
+	added = feed->len;
+	x += added;
+    }
+
+    if (!ISSET(NO_NEWLINES) && !feed->midway && added > 0) {
+	filestruct *rest = make_new_node(bot);
+
+	rest->data = mallocstrcpy(NULL, bot->data + x);
+	rest->next = bot->next;
+
+	if (bot->next != NULL)
+	    bot->next->prev = rest;
+	else
+	    buffer->filebot = rest;
+	bot->next = rest;
+
+	move_along(buffer, bot, x, rest, 0);
+
+	null_at(&bot->data, x);
+#ifndef NANO_TINY
+	edit_stamp++;
+#endif
+	buffer->totsize++;
+	added_magicline = TRUE;
+
+	bot = rest;
+	x = 0;
+    }
+
+    feed->spot = bot;
+    feed->spot_x = x;
+
+    free(feed->line);
+    feed->line = NULL;
+    feed->len = 0;
+    feed->size = 0;
+
+    return added_magicline;
+}
+
+#ifndef NANO_TINY
+/* Set the format of the given buffer according to the format that was
+ * detected while feeding it lines. */
+void set_feed_format(openfilestruct *buffer, int format)
+{
+    if (format == 2)
+	buffer->fmt = MAC_FILE;
+    else if (format == 1)
+	buffer->fmt = DOS_FILE;
+
+    if (ISSET(MAKE_IT_UNIX))
+	buffer->fmt = NIX_FILE;
+}
+#endif
+
+/* Tell how many lines were read in through feed, and in what format. */
+void report_feed(const feedstruct *feed)
+{
+    unsigned long lines = (unsigned long)feed->lines;
+
+#ifndef NANO_TINY
+    if (feed->format == 3)
+	statusbar(P_("Read %lu line (Converted from DOS and Mac format)",
+		"Read %lu lines (Converted from DOS and Mac format)",
+		lines), lines);
+    else if (feed->format == 2)
+	statusbar(P_("Read %lu line (Converted from Mac format)",
+		"Read %lu lines (Converted from Mac format)", lines), lines);
+    else if (feed->format == 1)
+	statusbar(P_("Read %lu line (Converted from DOS format)",
+		"Read %lu lines (Converted from DOS format)", lines), lines);
+    else
+#endif
+	statusbar(P_("Read %lu line", "Read %lu lines", lines), lines);
+}
+
+#ifndef DISABLE_FOLLOW
+/* Read the followed file of buffer from fd, starting at the beginning
+ * of its incomplete last line (whose text must have been removed from
+ * the buffer), and add the lines to the buffer.  Return the number of
+ * lines that were added. */
+size_t read_followed(openfilestruct *buffer, int fd)
+{
+    followstruct *follow = buffer->follow;
+    off_t offset = follow->size - follow->partial;
+    /* When not at the start, the incomplete line was counted before. */
+    size_t known = (offset > 0) ? 1 : 0;
+    char chunk[BUFSIZ * 8];
+    feedstruct feed;
+    ssize_t got;
+
+    memset(&feed, 0, sizeof(feedstruct));
+    feed.buffer = buffer;
+    feed.lines = known;
+    feed.format = follow->format;
+    feed.keep_top = (offset == 0);
+
+    if (lseek(fd, offset, SEEK_SET) == offset) {
+	while ((got = read(fd, chunk, sizeof(chunk))) > 0) {
+	    feed_text(&feed, chunk, got);
+	    offset += got;
+	}
+    }
+
+    follow->size = offset;
+    follow->partial = feed.len;
+    follow->magic = finish_feed(&feed);
+    follow->format = feed.format;
+
+    set_feed_format(buffer, feed.format);
+
+    return feed.lines - known;
+}
+
+/* Read in the current buffer's file, and start watching it, so that
+ * whatever gets appended to it later can be added to the buffer. */
+void start_following(void)
+{
+    followstruct *follow = (followstruct *)nmalloc(sizeof(followstruct));
+    char *dir = mallocstrcpy(NULL, openfile->filename);
+    struct stat fileinfo;
+    size_t lines;
+    int fd, watch_error = 0;
+
+    follow->wd = -1;
+    follow->dirwd = -1;
+    follow->size = 0;
+    follow->partial = 0;
+    follow->magic = FALSE;
+    follow->format = 0;
+    follow->pending = FALSE;
+    openfile->follow = follow;
+
+    if (follow_fd == -1)
+	follow_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    /* Set up the watches before reading, so that nothing gets missed. */
+    if (follow_fd != -1) {
+	follow->dirwd = inotify_add_watch(follow_fd, dirname(dir),
+				FOLLOW_DIR_EVENTS);
+	follow->wd = inotify_add_watch(follow_fd, openfile->filename,
+				FOLLOW_FILE_EVENTS);
+    }
+    if (follow->wd == -1)
+	watch_error = errno;
+
+    free(dir);
+
+    fd = open(openfile->filename, O_RDONLY);
+
+    if (fd == -1 || fstat(fd, &fileinfo) == -1) {
+	statusbar(_("Error reading %s: %s"), openfile->filename,
+		strerror(errno));
+	if (fd != -1)
+	    close(fd);
+	stop_following(openfile);
+	return;
+    }
+
+    follow->dev = fileinfo.st_dev;
+    follow->ino = fileinfo.st_ino;
+
+    lines = read_followed(openfile, fd);
+    close(fd);
+
+    if (watch_error != 0) {
+	statusbar(_("Can't follow %s: %s"), openfile->filename,
+		strerror(watch_error));
+	stop_following(openfile);
+    } else
+	statusbar(P_("Read %lu line (following)",
+		"Read %lu lines (following)", (unsigned long)lines),
+		(unsigned long)lines);
+}
+
+/* Return TRUE if a buffer other than the given one uses watch wd.  The
+ * given buffer must still be linked into the list of open buffers. */
+bool watch_in_use(int wd, const openfilestruct *buffer)
+{
+    const openfilestruct *other = buffer->next;
+
+    for (; other != buffer; other = other->next) {
+	if (other->follow != NULL && (other->follow->wd == wd ||
+		other->follow->dirwd == wd))
+	    return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* Stop following the file of the given buffer, which must still be
+ * linked into the list of open buffers. */
+void stop_following(openfilestruct *buffer)
+{
+    followstruct *follow = buffer->follow;
+
+    if (follow == NULL)
+	return;
+
+    if (follow->wd != -1 && !watch_in_use(follow->wd, buffer))
+	inotify_rm_watch(follow_fd, follow->wd);
+    if (follow->dirwd != -1 && !watch_in_use(follow->dirwd, buffer))
+	inotify_rm_watch(follow_fd, follow->dirwd);
+
+    free(follow);
+    buffer->follow = NULL;
+}
+
+/* Bring the given buffer up to date with its followed file: add what
+ * was appended to the file, or read it in anew when the file was
+ * truncated or replaced.  When the cursor was on the last line, keep it
+ * there and scroll along.  Return TRUE if the buffer changed. */
+bool follow_file(openfilestruct *buffer)
+{
+    followstruct *follow = buffer->follow;
+    struct stat fileinfo;
+    bool reload, at_end;
+    ssize_t lineno = buffer->current->lineno;
+    size_t current_x = buffer->current_x;
+    int fd = open(buffer->filename, O_RDONLY);
+
+    /* If the file is gone, wait for it to reappear. */
+    if (fd == -1)
+	return FALSE;
+
+    if (fstat(fd, &fileinfo) == -1 || (!S_ISREG(fileinfo.st_mode))) {
+	close(fd);
+	return FALSE;
+    }
+
+    /* A file whose watch is gone was deleted, even when the new one got
+     * the same inode number. */
+    reload = (follow->wd == -1 || fileinfo.st_dev != follow->dev ||
+		fileinfo.st_ino != follow->ino || fileinfo.st_size < follow->size);
+
+    if (!reload && fileinfo.st_size == follow->size) {
+	close(fd);
+	return FALSE;
+    }
+
+    at_end = (buffer->current == buffer->filebot ||
+		buffer->current->next == buffer->filebot);
+
+    if (reload) {
+	/* Watch the new file instead of the old one. */
+	if (follow->wd == -1 || fileinfo.st_dev != follow->dev ||
+		fileinfo.st_ino != follow->ino) {
+	    if (follow->wd != -1 && !watch_in_use(follow->wd, buffer))
+		inotify_rm_watch(follow_fd, follow->wd);
+	    follow->wd = inotify_add_watch(follow_fd, buffer->filename,
+				FOLLOW_FILE_EVENTS);
+	    follow->dev = fileinfo.st_dev;
+	    follow->ino = fileinfo.st_ino;
+	}
+
+	free_filestruct(buffer->fileage);
+	buffer->fileage = make_new_node(NULL);
+	buffer->fileage->data = mallocstrcpy(NULL, "");
+	buffer->filebot = buffer->fileage;
+	buffer->edittop = buffer->fileage;
+	buffer->current = buffer->fileage;
+	buffer->totsize = 0;
+	buffer->mark_set = FALSE;
+	buffer->mark_begin = NULL;
+
+	follow->size = 0;
+	follow->partial = 0;
+	follow->magic = FALSE;
+	follow->format = 0;
+    } else if (follow->partial > 0) {
+	/* Take the incomplete last line out of the buffer, as it will
+	 * be read in again together with its continuation. */
+	filestruct *bot = buffer->filebot;
+
+	if (follow->magic) {
+	    buffer->filebot = bot->prev;
+	    buffer->filebot->next = NULL;
+	    if (buffer->edittop == bot)
+		buffer->edittop = buffer->filebot;
+	    if (buffer->current == bot)
+		buffer->current = buffer->filebot;
+	    if (buffer->mark_begin == bot) {
+		buffer->mark_begin = buffer->filebot;
+		buffer->mark_begin_x = 0;
+	    }
+	    delete_node(bot);
+	    buffer->totsize--;
+	    bot = buffer->filebot;
+	}
+
+	buffer->totsize -= mbstrlen(bot->data);
+	bot->data[0] = '\0';
+#ifndef NANO_TINY
+	edit_stamp++;
+#endif
+	if (buffer->current == bot)
+	    buffer->current_x = 0;
+	if (buffer->mark_begin == bot)
+	    buffer->mark_begin_x = 0;
+    }
+
+    read_followed(buffer, fd);
+    close(fd);
+
+    if (at_end) {
+	filestruct *top = buffer->filebot;
+	int rows = 1;
+
+	buffer->current = buffer->filebot;
+	buffer->current_x = 0;
+	buffer->placewewant = 0;
+
+	/* Scroll so that the last line is at the bottom of the window. */
+	if (buffer->filebot->lineno >= buffer->edittop->lineno + editwinrows) {
+	    while (rows < editwinrows && top->prev != NULL) {
+		top = top->prev;
+		rows++;
+	    }
+	    buffer->edittop = top;
+	}
+    } else if (reload) {
+	/* Try to stay on the same line. */
+	while (buffer->current->next != NULL && buffer->current->lineno < lineno)
+	    buffer->current = buffer->current->next;
+	buffer->current_x = MIN(current_x, strlen(buffer->current->data));
+	buffer->placewewant = 0;
+    }
+
+    return TRUE;
+}
+
+/* Read the pending inotify events, and bring the buffers whose files
+ * changed up to date.  Return TRUE if the current buffer changed. */
+bool handle_follow_events(void)
+{
+    union {
+	struct inotify_event event;
+	char bytes[BUFSIZ];
+    } events;
+    openfilestruct *buffer;
+    bool changed = FALSE;
+    ssize_t got;
+
+    while ((got = read(follow_fd, &events, sizeof(events))) > 0) {
+	char *p = events.bytes;
+
+	while (p < events.bytes + got) {
+	    struct inotify_event *event = (struct inotify_event *)p;
+
+	    buffer = openfile;
+	    do {
+		followstruct *follow = buffer->follow;
+
+		if (follow == NULL)
+		    ;
+		else if (event->wd == follow->wd || event->mask & IN_Q_OVERFLOW) {
+		    if (event->mask & IN_IGNORED)
+			follow->wd = -1;
+		    follow->pending = TRUE;
+		} else if (event->wd == follow->dirwd && event->len > 0 &&
+			strcmp(event->name, tail(buffer->filename)) == 0)
+		    follow->pending = TRUE;
+
+		buffer = buffer->next;
+	    } while (buffer != openfile);
+
+	    p += sizeof(struct inotify_event) + event->len;
+	}
+    }
+
+    buffer = openfile;
+    do {
+	if (buffer->follow != NULL && buffer->follow->pending) {
+	    buffer->follow->pending = FALSE;
+	    if (follow_file(buffer) && buffer == openfile)
+		changed = TRUE;
+	}
+	buffer = buffer->next;
+    } while (buffer != openfile);
+
+    return changed;
+}
+#endif /* !DISABLE_FOLLOW */
+
 /* Open the file (and decide if it exists).  If newfie is TRUE, display
  * "New File" if the file is missing.  Otherwise, say "[filename] not
  * found".
@@ -1122,6 +1738,8 @@ void do_insertfile(
     bool edittop_inside = FALSE;
 #ifndef NANO_TINY
     bool right_side_up = FALSE, single_line = FALSE;
+    filestruct *piped = NULL;
+	/* The text to feed to the command, if any. */
 #endif
 
     while (TRUE) {
@@ -1184,7 +1802,7 @@ void do_insertfile(
 #ifndef DISABLE_MULTIBUFFER
 	    if (func == new_buffer_void) {
 		/* Don't allow toggling if we're in view mode. */
-		if (!ISSET(VIEW_MODE))
+		if (!in_view_mode())
 		    TOGGLE(MULTIBUFFER);
 		else
 		    beep();
@@ -1221,6 +1839,50 @@ void do_insertfile(
 		continue;
 
 #ifndef NANO_TINY
+	    if (execute) {
+		bool in_place = TRUE;
+#ifndef DISABLE_MULTIBUFFER
+		in_place = !ISSET(MULTIBUFFER);
+#endif
+		/* A command that starts with a pipe symbol gets the marked
+		 * text, or the whole buffer, on its standard input.  When
+		 * the output goes into the current buffer, it replaces that
+		 * text, and the whole filtering is undone in a single go. */
+		if (answer[0] == '|') {
+		    if (in_place)
+			add_undo(FILTER_BEGIN);
+
+		    piped = take_piped_text(in_place);
+		}
+
+		/* Convert newlines to nulls in the given command. */
+		sunder(answer);
+		align(&answer);
+
+#ifndef DISABLE_MULTIBUFFER
+		if (!in_place)
+		    /* Open a blank buffer. */
+		    open_buffer("", FALSE);
+#endif
+
+		/* Start the command, whose output then goes into the
+		 * current buffer as it arrives. */
+		if (execute_command(piped != NULL ? answer + 1 : answer,
+			piped, in_place))
+		    piped = NULL;
+		else if (piped != NULL && in_place)
+		    add_undo(FILTER_END);
+
+#ifndef DISABLE_MULTIBUFFER
+		if (!in_place)
+		    display_buffer();
+		else
+#endif
+		    edit_refresh();
+
+		break;
+	    }
+
 	    /* Keep track of whether the mark begins inside the
 	     * partition and will need adjustment. */
 	    if (openfile->mark_set) {
@@ -1254,36 +1916,12 @@ void do_insertfile(
 	    sunder(answer);
 	    align(&answer);
 
-#ifndef NANO_TINY
-	    if (execute) {
-#ifndef DISABLE_MULTIBUFFER
-		if (ISSET(MULTIBUFFER))
-		    /* Open a blank buffer. */
-		    open_buffer("", FALSE);
-#endif
+	    /* Make sure the path to the file specified in answer is
+	     * tilde-expanded. */
+	    answer = mallocstrassn(answer, real_dir_from_tilde(answer));
 
-		/* Save the command's output in the current buffer. */
-		execute_command(answer);
-
-#ifndef DISABLE_MULTIBUFFER
-		if (ISSET(MULTIBUFFER)) {
-		    /* Move back to the beginning of the first line of
-		     * the buffer. */
-		    openfile->current = openfile->fileage;
-		    openfile->current_x = 0;
-		    openfile->placewewant = 0;
-		}
-#endif
-	    } else
-#endif /* !NANO_TINY */
-	    {
-		/* Make sure the path to the file specified in answer is
-		 * tilde-expanded. */
-		answer = mallocstrassn(answer, real_dir_from_tilde(answer));
-
-		/* Save the file specified in answer in the current buffer. */
-		open_buffer(answer, TRUE);
-	    }
+	    /* Save the file specified in answer in the current buffer. */
+	    open_buffer(answer, TRUE);
 
 #ifndef DISABLE_MULTIBUFFER
 	    if (ISSET(MULTIBUFFER)) {
@@ -1293,9 +1931,6 @@ void do_insertfile(
 #ifndef DISABLE_HISTORIES
 		if (ISSET(POS_HISTORY)) {
 		    ssize_t priorline, priorcol;
-#ifndef NANO_TINY
-		    if (!execute)
-#endif
 		    if (check_poshistory(answer, &priorline, &priorcol))
 			do_gotolinecolumn(priorline, priorcol, FALSE, FALSE);
 		}
@@ -1371,6 +2006,9 @@ void do_insertfile(
 	    break;
 	}
     }
+#ifndef NANO_TINY
+    free_filestruct(piped);
+#endif
     free(ans);
 }
 
@@ -1385,7 +2023,7 @@ void do_insertfile_void(void)
     }
 
 #ifndef DISABLE_MULTIBUFFER
-    if (ISSET(VIEW_MODE) && !ISSET(MULTIBUFFER))
+    if (in_view_mode() && !ISSET(MULTIBUFFER))
 	statusbar(_("Key invalid in non-multibuffer mode"));
     else
 #endif
@@ -1710,9 +2348,64 @@ void init_backup_dir(void)
 }
 #endif /* !NANO_TINY */
 
-/* Read from inn, write to out.  We assume inn is opened for reading,
- * and out for writing.  We return 0 on success, -1 on read error, or -2
- * on write error. */
+/* Let the kernel copy the rest of the file open on in to the file open
+ * on out, without passing the data through user space: by sharing the
+ * data blocks of a whole file where the filesystem supports that, or
+ * else with copy_file_range() or sendfile().  Both offsets are advanced
+ * past what was copied.  Return 0 when everything was copied, 1 when the
+ * kernel can't do (the rest of) this copy, or -2 on error. */
+int copy_in_kernel(int in, int out)
+{
+    ssize_t copied = -1;
+
+    /* None of the methods can write to a file opened for appending. */
+    if (fcntl(out, F_GETFL) & O_APPEND)
+	return 1;
+
+#ifdef FICLONE
+    {
+	struct stat outstat;
+
+	/* A reflink can only replace the full contents of out. */
+	if (lseek(in, 0, SEEK_CUR) == 0 && lseek(out, 0, SEEK_CUR) == 0 &&
+		fstat(out, &outstat) == 0 && outstat.st_size == 0 &&
+		ioctl(out, FICLONE, in) == 0) {
+	    lseek(in, 0, SEEK_END);
+	    lseek(out, 0, SEEK_END);
+	    return 0;
+	}
+    }
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+    do
+	copied = copy_file_range(in, NULL, out, NULL, 1 << 30, 0);
+    while (copied > 0 || (copied < 0 && errno == EINTR));
+
+    if (copied == 0)
+	return 0;
+    if (errno != EXDEV && errno != EINVAL && errno != ENOSYS &&
+		errno != EOPNOTSUPP && errno != EBADF)
+	return -2;
+#endif
+
+#if defined(HAVE_SENDFILE) && defined(HAVE_SYS_SENDFILE_H)
+    do
+	copied = sendfile(out, in, NULL, 1 << 30);
+    while (copied > 0 || (copied < 0 && errno == EINTR));
+
+    if (copied == 0)
+	return 0;
+    if (errno != EINVAL && errno != ENOSYS)
+	return -2;
+#endif
+
+    return 1;
+}
+
+/* Read from inn, write to out.  We assume inn is freshly opened for
+ * reading, and out for writing.  We return 0 on success, -1 on read
+ * error, or -2 on write error. */
 int copy_file(FILE *inn, FILE *out)
 {
     int retval = 0;
@@ -1721,6 +2414,20 @@ int copy_file(FILE *inn, FILE *out)
 
     assert(inn != NULL && out != NULL && inn != out);
 
+    /* Try to have the kernel do the copy; if it can't, or can do only
+     * part of it, copy (the rest) through our own buffer.  As nothing
+     * has been read from inn yet, only out's buffer needs flushing for
+     * both streams to agree with the offsets of their descriptors. */
+    if (fflush(out) != 0)
+	retval = -2;
+    else
+	retval = copy_in_kernel(fileno(inn), fileno(out));
+
+    if (retval != 1)
+	goto close_both;
+
+    retval = 0;
+
     do {
 	charsread = fread(buf, sizeof(char), BUFSIZ, inn);
 	if (charsread == 0 && ferror(inn)) {
@@ -1733,6 +2440,7 @@ int copy_file(FILE *inn, FILE *out)
 	}
     } while (charsread > 0);
 
+  close_both:
     if (fclose(inn) == EOF)
 	retval = -1;
     if (fclose(out) == EOF)
@@ -1741,6 +2449,154 @@ int copy_file(FILE *inn, FILE *out)
     return retval;
 }
 
+/* Write the count pieces to fd, resuming after partial writes.  Return
+ * TRUE on success, or FALSE with errno set on error. */
+bool write_pieces(int fd, struct iovec *pieces, int count)
+{
+    while (count > 0) {
+	ssize_t written = writev(fd, pieces, count);
+
+	if (written < 0 && errno == EINTR)
+	    continue;
+
+	if (written <= 0) {
+	    if (written == 0)
+		errno = ENOSPC;
+	    return FALSE;
+	}
+
+	/* Skip the pieces that went out whole, and trim the one that
+	 * went out partially. */
+	while (count > 0 && (size_t)written >= pieces->iov_len) {
+	    written -= pieces->iov_len;
+	    pieces++;
+	    count--;
+	}
+
+	if (count > 0) {
+	    pieces->iov_base = (char *)pieces->iov_base + written;
+	    pieces->iov_len -= written;
+	}
+    }
+
+    return TRUE;
+}
+
+/* Add the len bytes at data to the batch of pieces, first writing the
+ * batch out to fd when it is full.  Return FALSE on a write error. */
+bool add_piece(int fd, struct iovec *pieces, int *count, const char
+	*data, size_t len)
+{
+    if (*count == MAX_WRITE_PIECES) {
+	if (!write_pieces(fd, pieces, *count))
+	    return FALSE;
+	*count = 0;
+    }
+
+    pieces[*count].iov_base = (char *)data;
+    pieces[*count].iov_len = len;
+    (*count)++;
+
+    return TRUE;
+}
+
+/* Write the lines of the current buffer to fd in a single pass, without
+ * modifying them: nulls, which are stored as newlines, are turned back
+ * into nulls, and the line endings of the file's format are added, while
+ * the lines are gathered into batches for writev().  Set *lineswritten
+ * to the number of lines written.  Return TRUE on success, or FALSE with
+ * errno set on error. */
+bool write_lines(int fd, size_t *lineswritten)
+{
+    struct iovec pieces[MAX_WRITE_PIECES];
+    int count = 0;
+    const filestruct *fileptr = openfile->fileage;
+    const char *eol = "\n";
+    size_t eol_len = 1;
+
+#ifndef NANO_TINY
+    if (openfile->fmt == DOS_FILE) {
+	eol = "\r\n";
+	eol_len = 2;
+    } else if (openfile->fmt == MAC_FILE)
+	eol = "\r";
+#endif
+
+    *lineswritten = 0;
+
+    while (fileptr != NULL) {
+	const char *start = fileptr->data, *end = start;
+
+	for (;; end++) {
+	    if (*end != '\n' && *end != '\0')
+		continue;
+
+	    if (end > start && !add_piece(fd, pieces, &count, start,
+			end - start))
+		return FALSE;
+
+	    if (*end == '\0')
+		break;
+
+	    if (!add_piece(fd, pieces, &count, "", 1))
+		return FALSE;
+
+	    start = end + 1;
+	}
+
+	/* If we're on the last line of the file, don't write a newline
+	 * character after it.  If the last line of the file is blank,
+	 * this means that zero bytes are written, in which case we
+	 * don't count the last line in the total lines written. */
+	if (fileptr == openfile->filebot) {
+	    if (fileptr->data[0] == '\0')
+		(*lineswritten)--;
+	} else if (!add_piece(fd, pieces, &count, eol, eol_len))
+	    return FALSE;
+
+	fileptr = fileptr->next;
+	(*lineswritten)++;
+    }
+
+    return write_pieces(fd, pieces, count);
+}
+
+#ifndef NANO_TINY
+/* Create a temporary file in the directory of target, with the owner,
+ * group, and permissions recorded in st, so that it can be written and
+ * then renamed over target.  Return its file descriptor and set *name
+ * to its name, or return -1 if such a file can't be made. */
+int open_atomic_tempfile(const char *target, const struct stat *st,
+	char **name)
+{
+    int fd;
+
+    *name = charalloc(strlen(target) + 8);
+    sprintf(*name, "%s.XXXXXX", target);
+
+    fd = mkstemp(*name);
+
+    if (fd == -1) {
+	free(*name);
+	*name = NULL;
+	return -1;
+    }
+
+    /* The ownership is set first, as that may clear set-ID bits. */
+    if (((st->st_uid != geteuid() || st->st_gid != getegid()) &&
+		fchown(fd, st->st_uid, st->st_gid) == -1) ||
+		fchmod(fd, st->st_mode & 07777) == -1) {
+	close(fd);
+	unlink(*name);
+	free(*name);
+	*name = NULL;
+	return -1;
+    }
+
+    return fd;
+}
+#endif
+
 /* Write a file out to disk.  If f_open isn't NULL, we assume that it is
  * a stream associated with the file, and we don't try to open it
  * ourselves.  If tmp is TRUE, we set the umask to disallow anyone else
@@ -1755,6 +2611,11 @@ int copy_file(FILE *inn, FILE *out)
  * filename.  nonamechange is ignored if tmp is FALSE, we're appending,
  * or we're prepending.
  *
+ * When the atomic-save flag is set and an existing file is overwritten,
+ * we write into a temporary file in the same directory and rename it
+ * over the original only once it is safely on disk, so that a crash
+ * halfway through the write can't leave a truncated file behind.
+ *
  * Return TRUE on success or FALSE on error. */
 bool write_file(const char *name, FILE *f_open, bool tmp, append_type
 	append, bool nonamechange)
@@ -1763,7 +2624,6 @@ bool write_file(const char *name, FILE *f_open, bool tmp, append_type
 	/* Instead of returning in this function, you should always
 	 * set retval and then goto cleanup_and_exit. */
     size_t lineswritten = 0;
-    const filestruct *fileptr = openfile->fileage;
     int fd;
 	/* The file descriptor we use. */
     mode_t original_umask = 0;
@@ -1782,6 +2642,12 @@ bool write_file(const char *name, FILE *f_open, bool tmp, append_type
 	/* The actual file, realname, we are writing to. */
     char *tempname = NULL;
 	/* The name of the temporary file we write to on prepend. */
+#ifndef NANO_TINY
+    char *atomicname = NULL;
+	/* The name of the temporary file we write to on atomic save. */
+    char *target = NULL;
+	/* The file that the atomic-save file will replace. */
+#endif
 
     assert(name != NULL);
 
@@ -1913,10 +2779,12 @@ bool write_file(const char *name, FILE *f_open, bool tmp, append_type
 	    goto cleanup_and_exit;
 	}
 
+	/* The backup isn't opened for appending, as the kernel can't copy
+	 * into such a file. */
 	if (ISSET(INSECURE_BACKUP))
-	    backup_cflags = O_WRONLY | O_CREAT | O_APPEND;
+	    backup_cflags = O_WRONLY | O_CREAT | O_TRUNC;
 	else
-	    backup_cflags = O_WRONLY | O_CREAT | O_EXCL | O_APPEND;
+	    backup_cflags = O_WRONLY | O_CREAT | O_EXCL;
 
 	backup_fd = open(backupname, backup_cflags,
 		S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
@@ -2053,7 +2921,34 @@ bool write_file(const char *name, FILE *f_open, bool tmp, append_type
 	}
     }
 
+#ifndef NANO_TINY
+    /* When saving atomically, write to a temporary file beside the
+     * existing one (or beside the file a symlink points to).  A file
+     * with other hard links is overwritten in place, so that the links
+     * stay intact, and so is one whose ownership we can't reproduce. */
+    if (ISSET(ATOMIC_SAVE) && f_open == NULL && !tmp &&
+		append == OVERWRITE && realexists && S_ISREG(st.st_mode) &&
+		st.st_nlink == 1 && (target = realpath(realname, NULL)) != NULL) {
+	fd = open_atomic_tempfile(target, &st, &atomicname);
+
+	if (fd != -1) {
+	    umask(original_umask);
+
+	    f = fdopen(fd, "wb");
+
+	    if (f == NULL) {
+		statusbar(_("Error writing %s: %s"), atomicname,
+			strerror(errno));
+		close(fd);
+		goto cleanup_and_exit;
+	    }
+	}
+    }
+
+    if (f_open == NULL && atomicname == NULL) {
+#else
     if (f_open == NULL) {
+#endif
 	/* Now open the file in place.  Use O_EXCL if tmp is TRUE.  This
 	 * is copied from joe, because wiggy says so *shrug*. */
 	fd = open(realname, O_WRONLY | O_CREAT | ((append == APPEND) ?
@@ -2088,55 +2983,12 @@ bool write_file(const char *name, FILE *f_open, bool tmp, append_type
      * a selection. */
     assert(openfile->fileage != NULL && openfile->filebot != NULL);
 
-    while (fileptr != NULL) {
-	size_t data_len = strlen(fileptr->data), size;
-
-	/* Convert newlines to nulls, just before we write to disk. */
-	sunder(fileptr->data);
-
-	size = fwrite(fileptr->data, sizeof(char), data_len, f);
-
-	/* Convert nulls to newlines.  data_len is the string's real
-	 * length. */
-	unsunder(fileptr->data, data_len);
-
-	if (size < data_len) {
-	    statusbar(_("Error writing %s: %s"), realname,
-		strerror(errno));
-	    fclose(f);
-	    goto cleanup_and_exit;
-	}
-
-	/* If we're on the last line of the file, don't write a newline
-	 * character after it.  If the last line of the file is blank,
-	 * this means that zero bytes are written, in which case we
-	 * don't count the last line in the total lines written. */
-	if (fileptr == openfile->filebot) {
-	    if (fileptr->data[0] == '\0')
-		lineswritten--;
-	} else {
-#ifndef NANO_TINY
-	    if (openfile->fmt == DOS_FILE || openfile->fmt == MAC_FILE) {
-		if (putc('\r', f) == EOF) {
-		    statusbar(_("Error writing %s: %s"), realname,
-			strerror(errno));
-		    fclose(f);
-		    goto cleanup_and_exit;
-		}
-	    }
-
-	    if (openfile->fmt != MAC_FILE)
-#endif
-		if (putc('\n', f) == EOF) {
-		    statusbar(_("Error writing %s: %s"), realname,
-			strerror(errno));
-		    fclose(f);
-		    goto cleanup_and_exit;
-		}
-	}
-
-	fileptr = fileptr->next;
-	lineswritten++;
+    /* Write the lines directly to the descriptor, after anything that
+     * is still buffered in the stream. */
+    if (fflush(f) != 0 || !write_lines(fileno(f), &lineswritten)) {
+	statusbar(_("Error writing %s: %s"), realname, strerror(errno));
+	fclose(f);
+	goto cleanup_and_exit;
     }
 
     /* If we're prepending, open the temp file, and append it to f. */
@@ -2167,6 +3019,32 @@ bool write_file(const char *name, FILE *f_open, bool tmp, append_type
 	}
 
 	unlink(tempname);
+#ifndef NANO_TINY
+    } else if (atomicname != NULL) {
+	/* Make sure the new contents are on disk before they replace
+	 * the old ones. */
+	if (fsync(fileno(f)) != 0) {
+	    statusbar(_("Error writing %s: %s"), atomicname,
+		strerror(errno));
+	    fclose(f);
+	    goto cleanup_and_exit;
+	}
+
+	if (fclose(f) != 0) {
+	    statusbar(_("Error writing %s: %s"), atomicname,
+		strerror(errno));
+	    goto cleanup_and_exit;
+	}
+
+	if (rename(atomicname, target) == -1) {
+	    statusbar(_("Error writing %s: %s"), realname,
+		strerror(errno));
+	    goto cleanup_and_exit;
+	}
+
+	free(atomicname);
+	atomicname = NULL;
+#endif
     } else if (fclose(f) != 0) {
 	    statusbar(_("Error writing %s: %s"), realname,
 		strerror(errno));
@@ -2202,11 +3080,27 @@ bool write_file(const char *name, FILE *f_open, bool tmp, append_type
 		(unsigned long)lineswritten);
 	openfile->modified = FALSE;
 	titlebar(NULL);
+#ifndef DISABLE_COLOR
+#ifndef NANO_TINY
+	/* Saving just the marked region is not a save of the file. */
+	if (!openfile->mark_set)
+#endif
+	    lint_after_save();
+#endif
     }
 
     retval = TRUE;
 
   cleanup_and_exit:
+#ifndef NANO_TINY
+    /* A failed atomic save leaves the original untouched; just remove
+     * the partial copy. */
+    if (atomicname != NULL) {
+	unlink(atomicname);
+	free(atomicname);
+    }
+    free(target);
+#endif
     free(realname);
     free(tempname);
 
@@ -2613,6 +3507,23 @@ void free_chararray(char **array, size_t len)
 #endif
 
 #ifndef DISABLE_TABCOMP
+static candidate *file_candidates = NULL;
+	/* The sorted names in the directory that was last completed in. */
+static size_t file_candidates_len = 0;
+	/* The number of those names. */
+static char *candidates_dir = NULL;
+	/* The path of that directory. */
+static struct stat candidates_info;
+	/* What stat() said about that directory just before it was read. */
+static time_t candidates_time = 0;
+	/* When that directory was read. */
+static candidate *user_candidates = NULL;
+	/* The sorted names and home directories of all users. */
+static size_t user_candidates_len = 0;
+	/* The number of users. */
+static bool users_fetched = FALSE;
+	/* Whether the users have been fetched yet. */
+
 /* Is the given path a directory? */
 bool is_dir(const char *buf)
 {
@@ -2649,52 +3560,211 @@ bool is_dir(const char *buf)
  * This code is 'as is' with no warranty.
  * This code may safely be consumed by a BSD or GPL license. */
 
+/* Compare two candidates for completion by their names, bytewise. */
+int candidate_compare(const void *va, const void *vb)
+{
+    const candidate *a = (const candidate *)va;
+    const candidate *b = (const candidate *)vb;
+
+    return strcmp(a->name, b->name);
+}
+
+/* Return the index of the first candidate in the sorted list (of len
+ * entries) whose name begins with the first prefix_len bytes of prefix,
+ * or where such a name would be.  Any further such names follow it. */
+size_t first_candidate(const candidate *list, size_t len,
+	const char *prefix, size_t prefix_len)
+{
+    size_t low = 0, high = len;
+
+    while (low < high) {
+	size_t middle = low + (high - low) / 2;
+
+	if (strncmp(list[middle].name, prefix, prefix_len) < 0)
+	    low = middle + 1;
+	else
+	    high = middle;
+    }
+
+    return low;
+}
+
+/* Free the given list of candidates. */
+void free_candidates(candidate *list, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+	free(list[i].name);
+	free(list[i].home);
+    }
+
+    free(list);
+}
+
+#ifdef DEBUG
+/* Free the names kept for tab completion. */
+void free_completions(void)
+{
+    free_candidates(file_candidates, file_candidates_len);
+    free_candidates(user_candidates, user_candidates_len);
+    free(candidates_dir);
+}
+#endif
+
+/* Make file_candidates hold the sorted names in the given directory.
+ * The directory is read only when it isn't the one that was read last,
+ * or when it was modified since.  As modification times count in whole
+ * seconds, a directory that was modified in the second that it was read
+ * gets read again too.  Return FALSE if the directory can't be read. */
+bool read_candidates(const char *dirname)
+{
+    struct stat info;
+    DIR *dir;
+    const struct dirent *nextdir;
+    size_t size = 64;
+
+    if (stat(dirname, &info) == -1)
+	return FALSE;
+
+    if (candidates_dir != NULL && strcmp(dirname, candidates_dir) == 0 &&
+		info.st_dev == candidates_info.st_dev &&
+		info.st_ino == candidates_info.st_ino &&
+		info.st_mtime == candidates_info.st_mtime &&
+		info.st_mtime < candidates_time)
+	return TRUE;
+
+    dir = opendir(dirname);
+
+    if (dir == NULL)
+	return FALSE;
+
+    free_candidates(file_candidates, file_candidates_len);
+
+    candidates_dir = mallocstrcpy(candidates_dir, dirname);
+    candidates_info = info;
+    candidates_time = time(NULL);
+
+    file_candidates = (candidate *)nmalloc(size * sizeof(candidate));
+    file_candidates_len = 0;
+
+    while ((nextdir = readdir(dir)) != NULL) {
+	candidate *entry;
+
+	if (file_candidates_len == size) {
+	    size *= 2;
+	    file_candidates = (candidate *)nrealloc(file_candidates,
+			size * sizeof(candidate));
+	}
+
+	entry = &file_candidates[file_candidates_len++];
+
+	entry->name = mallocstrcpy(NULL, nextdir->d_name);
+	entry->home = NULL;
+
+#ifdef _DIRENT_HAVE_D_TYPE
+	if (nextdir->d_type == DT_DIR)
+	    entry->isdir = 1;
+	else if (nextdir->d_type != DT_LNK &&
+		nextdir->d_type != DT_UNKNOWN)
+	    entry->isdir = 0;
+	else
+#endif
+	    entry->isdir = -1;
+    }
+
+    closedir(dir);
+
+    qsort(file_candidates, file_candidates_len, sizeof(candidate),
+	candidate_compare);
+
+    return TRUE;
+}
+
+/* Make user_candidates hold the sorted names and home directories of
+ * all users.  The password database can be slow to go through (when it
+ * comes from the network, for example), so this is done only once. */
+void fetch_users(void)
+{
+    const struct passwd *userdata;
+    size_t size = 64;
+
+    user_candidates = (candidate *)nmalloc(size * sizeof(candidate));
+
+    while ((userdata = getpwent()) != NULL) {
+	candidate *entry;
+
+	if (user_candidates_len == size) {
+	    size *= 2;
+	    user_candidates = (candidate *)nrealloc(user_candidates,
+			size * sizeof(candidate));
+	}
+
+	entry = &user_candidates[user_candidates_len++];
+
+	entry->name = mallocstrcpy(NULL, userdata->pw_name);
+	entry->home = mallocstrcpy(NULL, userdata->pw_dir);
+	entry->isdir = 1;
+    }
+    endpwent();
+
+    qsort(user_candidates, user_candidates_len, sizeof(candidate),
+	candidate_compare);
+
+    users_fetched = TRUE;
+}
+
 /* We consider the first buf_len characters of buf for ~username tab
  * completion. */
 char **username_tab_completion(const char *buf, size_t *num_matches,
 	size_t buf_len)
 {
     char **matches = NULL;
-    const struct passwd *userdata;
+    size_t i;
 
     assert(buf != NULL && num_matches != NULL && buf_len > 0);
 
     *num_matches = 0;
 
-    while ((userdata = getpwent()) != NULL) {
-	if (strncmp(userdata->pw_name, buf + 1, buf_len - 1) == 0) {
-	    /* Cool, found a match.  Add it to the list.  This makes a
-	     * lot more sense to me (Chris) this way... */
+    if (!users_fetched)
+	fetch_users();
+
+    /* The matching names are all together in the sorted list. */
+    for (i = first_candidate(user_candidates, user_candidates_len,
+		buf + 1, buf_len - 1); i < user_candidates_len &&
+		strncmp(user_candidates[i].name, buf + 1, buf_len - 1) == 0;
+		i++) {
+	const candidate *userdata = &user_candidates[i];
+
+	/* Cool, found a match.  Add it to the list.  This makes a
+	 * lot more sense to me (Chris) this way... */
 
 #ifndef DISABLE_OPERATINGDIR
-	    /* ...unless the match exists outside the operating
-	     * directory, in which case just go to the next match. */
-	    if (check_operating_dir(userdata->pw_dir, TRUE))
-		continue;
+	/* ...unless the match exists outside the operating
+	 * directory, in which case just go to the next match. */
+	if (check_operating_dir(userdata->home, TRUE))
+	    continue;
 #endif
 
-	    matches = (char **)nrealloc(matches, (*num_matches + 1) *
+	matches = (char **)nrealloc(matches, (*num_matches + 1) *
 					sizeof(char *));
-	    matches[*num_matches] = charalloc(strlen(userdata->pw_name) + 2);
-	    sprintf(matches[*num_matches], "~%s", userdata->pw_name);
-	    ++(*num_matches);
-	}
+	matches[*num_matches] = charalloc(strlen(userdata->name) + 2);
+	sprintf(matches[*num_matches], "~%s", userdata->name);
+	++(*num_matches);
     }
-    endpwent();
 
     return matches;
 }
 
 /* We consider the first buf_len characters of buf for filename tab
- * completion. */
+ * completion.  The names in the directory are read only once for as
+ * long as it doesn't change. */
 char **cwd_tab_completion(const char *buf, bool allow_files, size_t
 	*num_matches, size_t buf_len)
 {
     char *dirname = mallocstrcpy(NULL, buf), *filename;
-    size_t filenamelen;
+    size_t filenamelen, i;
     char **matches = NULL;
-    DIR *dir;
-    const struct dirent *nextdir;
 
     assert(dirname != NULL && num_matches != NULL);
 
@@ -2718,9 +3788,7 @@ char **cwd_tab_completion(const char *buf, bool allow_files, size_t
 
     assert(dirname[strlen(dirname) - 1] == '/');
 
-    dir = opendir(dirname);
-
-    if (dir == NULL) {
+    if (!read_candidates(dirname)) {
 	/* Don't print an error, just shut up and return. */
 	beep();
 	free(filename);
@@ -2730,47 +3798,54 @@ char **cwd_tab_completion(const char *buf, bool allow_files, size_t
 
     filenamelen = strlen(filename);
 
-    while ((nextdir = readdir(dir)) != NULL) {
+    /* The matching names are all together in the sorted list. */
+    for (i = first_candidate(file_candidates, file_candidates_len,
+		filename, filenamelen); i < file_candidates_len &&
+		strncmp(file_candidates[i].name, filename,
+		filenamelen) == 0; i++) {
+	const candidate *nextdir = &file_candidates[i];
 	bool skip_match = FALSE;
+	char *tmp;
 
 #ifdef DEBUG
-	fprintf(stderr, "Comparing \'%s\'\n", nextdir->d_name);
+	fprintf(stderr, "Comparing \'%s\'\n", nextdir->name);
 #endif
 	/* See if this matches. */
-	if (strncmp(nextdir->d_name, filename, filenamelen) == 0 &&
-		(*filename == '.' || (strcmp(nextdir->d_name, ".") != 0 &&
-		strcmp(nextdir->d_name, "..") != 0))) {
-	    /* Cool, found a match.  Add it to the list.  This makes a
-	     * lot more sense to me (Chris) this way... */
+	if (*filename != '.' && (strcmp(nextdir->name, ".") == 0 ||
+		strcmp(nextdir->name, "..") == 0))
+	    continue;
+
+	/* Cool, found a match.  Add it to the list.  This makes a
+	 * lot more sense to me (Chris) this way... */
 
-	    char *tmp = charalloc(strlen(dirname) + strlen(nextdir->d_name) + 1);
-	    sprintf(tmp, "%s%s", dirname, nextdir->d_name);
+	tmp = charalloc(strlen(dirname) + strlen(nextdir->name) + 1);
+	sprintf(tmp, "%s%s", dirname, nextdir->name);
 
 #ifndef DISABLE_OPERATINGDIR
-	    /* ...unless the match exists outside the operating
-	     * directory, in which case just go to the next match. */
-	    if (check_operating_dir(tmp, TRUE))
-		skip_match = TRUE;
+	/* ...unless the match exists outside the operating
+	 * directory, in which case just go to the next match. */
+	if (check_operating_dir(tmp, TRUE))
+	    skip_match = TRUE;
 #endif
 
-	    /* ...or unless the match isn't a directory and allow_files
-	     * isn't set, in which case just go to the next match. */
-	    if (!allow_files && !is_dir(tmp))
-		skip_match = TRUE;
+	/* ...or unless the match isn't a directory and allow_files
+	 * isn't set, in which case just go to the next match.  Only
+	 * ask when the directory didn't tell. */
+	if (!allow_files && (nextdir->isdir == 0 ||
+		(nextdir->isdir == -1 && !is_dir(tmp))))
+	    skip_match = TRUE;
 
-	    free(tmp);
+	free(tmp);
 
-	    if (skip_match)
-		continue;
+	if (skip_match)
+	    continue;
 
-	    matches = (char **)nrealloc(matches, (*num_matches + 1) *
+	matches = (char **)nrealloc(matches, (*num_matches + 1) *
 					sizeof(char *));
-	    matches[*num_matches] = mallocstrcpy(NULL, nextdir->d_name);
-	    ++(*num_matches);
-	}
+	matches[*num_matches] = mallocstrcpy(NULL, nextdir->name);
+	++(*num_matches);
     }
 
-    closedir(dir);
     free(dirname);
     free(filename);
 
@@ -3065,10 +4140,11 @@ void load_history(void)
 	} else {
 	    /* Load a history list (first the search history, then the
 	     * replace history) from the oldest entry to the newest.
-	     * Assume the last history entry is a blank line. */
+	     * Assume the last history entry is a blank line.  Gather the
+	     * strings of a list first, and then fill it in one go. */
 	    filestruct **history = &search_history;
-	    char *line = NULL;
-	    size_t buf_len = 0;
+	    char *line = NULL, **strings = NULL;
+	    size_t buf_len = 0, count = 0, size = 0;
 	    ssize_t read;
 
 	    while ((read = getline(&line, &buf_len, hist)) >= 0) {
@@ -3078,12 +4154,23 @@ void load_history(void)
 		}
 		if (read > 0) {
 		    unsunder(line, read);
-		    update_history(history, line);
-		} else
+		    if (count == size) {
+			size = (size == 0) ? 64 : size * 2;
+			strings = (char **)nrealloc(strings,
+				size * sizeof(char *));
+		    }
+		    strings[count++] = mallocstrcpy(NULL, line);
+		} else if (history == &search_history) {
+		    fill_history(history, strings, count);
+		    count = 0;
 		    history = &replace_history;
+		}
 	    }
 
+	    fill_history(history, strings, count);
+
 	    fclose(hist);
+	    free(strings);
 	    free(line);
 	}
 	free(nanohist);
@@ -3119,8 +4206,8 @@ void save_history(void)
     char *nanohist;
 
     /* Don't save unchanged or empty histories. */
-    if (!history_has_changed() || (searchbot->lineno == 1 &&
-		replacebot->lineno == 1))
+    if (!history_has_changed() || (searchage == searchbot &&
+		replaceage == replacebot))
 	return;
 
     nanohist = histfilename();
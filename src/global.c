@@ -41,7 +41,33 @@ bool func_key;
 bool focusing = FALSE;
 	/* Whether an update of the edit window should center the cursor. */
 
+#ifndef DISABLE_FOLLOW
+int follow_fd = -1;
+	/* The inotify instance that watches the followed files. */
+#endif
 #ifndef NANO_TINY
+int command_fd = -1;
+	/* The pipe from the command whose output is being inserted. */
+int command_input_fd = -1;
+	/* And the pipe to it, while it is being fed text. */
+#endif
+#ifndef DISABLE_COLOR
+int lint_fd = -1;
+	/* The pipe from the linter that runs in the background. */
+#endif
+#ifdef USE_PREFETCH
+int prefetch_fd = -1;
+	/* The pipe through which the browser's helper threads report. */
+#endif
+#ifdef USE_DIRWATCH
+int browser_watch_fd = -1;
+	/* The inotify instance that watches the browsed directory. */
+#endif
+
+#ifndef NANO_TINY
+size_t edit_stamp = 0;
+	/* Is incremented whenever the text of any line may have changed. */
+
 int controlleft = CONTROL_LEFT;
 int controlright = CONTROL_RIGHT;
 #endif
@@ -190,6 +216,8 @@ filestruct *replaceage = NULL;
 	/* The top of the replace string history list. */
 filestruct *replacebot = NULL;
 	/* The bottom of the replace string history list. */
+ssize_t history_length = MAX_SEARCH_HISTORY;
+	/* The maximum number of strings in each of those lists. */
 poshiststruct *position_history = NULL;
 	/* The cursor position history list. */
 #endif
@@ -1238,6 +1266,8 @@ void shortcut_init(void)
 #ifdef DEBUG
     print_sclist();
 #endif
+
+    build_shortcut_tables();
 }
 
 #ifndef DISABLE_COLOR
@@ -1263,12 +1293,166 @@ void set_spell_shortcuts(void)
 }
 #endif /* !DISABLE_COLOR */
 
+static const sc **keytable = NULL;
+	/* For each menu, a hash table with the first shortcut in that
+	 * menu for each keystroke, or NULL while the list may change. */
+static size_t keytable_size = 0;
+	/* The number of slots per menu in that table; a power of two. */
+static const subnfunc **functable = NULL;
+	/* A hash table with the first item in the list of functions for
+	 * each function. */
+static size_t functable_size = 0;
+	/* The number of slots in that table; a power of two. */
+
+/* Return the position of the given menu flag among the menu flags. */
+int menu_index(int menu)
+{
+    int index = 0;
+
+    while (menu > 1) {
+	menu >>= 1;
+	index++;
+    }
+
+    return index;
+}
+
+/* Return the starting slot in the shortcut table for the given
+ * keystroke, where meta says whether it is a Meta keystroke. */
+size_t keytable_hash(int seq, bool meta)
+{
+    return ((size_t)seq * 2 + meta) & (keytable_size - 1);
+}
+
+/* Return the starting slot in the function table for func. */
+size_t functable_hash(void (*func)(void))
+{
+    return ((size_t)func >> 4) & (functable_size - 1);
+}
+
+/* Throw away the dispatch tables, so that lookups fall back to walking
+ * the lists.  This must be done before the lists get changed. */
+void discard_shortcut_tables(void)
+{
+    free(keytable);
+    keytable = NULL;
+    free(functable);
+    functable = NULL;
+}
+
+/* (Re)build the tables for finding the shortcut that is bound to a
+ * keystroke in a menu, and the item in the list of functions that
+ * belongs to a shortcut.  Where the lists have several matches, only
+ * the first one goes into a table, so lookups give the same result as
+ * walking the lists, while the lists themselves keep their order. */
+void build_shortcut_tables(void)
+{
+    const sc *s;
+    const subnfunc *f;
+    size_t count = 0, slot;
+
+    discard_shortcut_tables();
+
+    /* Make each table at least twice as large as its number of items,
+     * to keep the probe sequences short. */
+    for (s = sclist; s != NULL; s = s->next)
+	count++;
+    for (keytable_size = 64; keytable_size < count * 2; keytable_size *= 2)
+	;
+    keytable = (const sc **)nmalloc(NUMBER_OF_MENUS * keytable_size *
+	sizeof(const sc *));
+    memset(keytable, 0, NUMBER_OF_MENUS * keytable_size *
+	sizeof(const sc *));
+
+    for (s = sclist; s != NULL; s = s->next) {
+	bool meta = (s->type == META);
+	int menu;
+
+	for (menu = 0; menu < NUMBER_OF_MENUS; menu++) {
+	    const sc **table = keytable + menu * keytable_size;
+
+	    if (!(s->menus & (1 << menu)))
+		continue;
+
+	    slot = keytable_hash(s->seq, meta);
+	    while (table[slot] != NULL && (table[slot]->seq != s->seq ||
+			(table[slot]->type == META) != meta))
+		slot = (slot + 1) & (keytable_size - 1);
+
+	    if (table[slot] == NULL)
+		table[slot] = s;
+	}
+    }
+
+    count = 0;
+    for (f = allfuncs; f != NULL; f = f->next)
+	count++;
+    for (functable_size = 64; functable_size < count * 2;
+		functable_size *= 2)
+	;
+    functable = (const subnfunc **)nmalloc(functable_size *
+	sizeof(const subnfunc *));
+    memset(functable, 0, functable_size * sizeof(const subnfunc *));
+
+    for (f = allfuncs; f != NULL; f = f->next) {
+	slot = functable_hash(f->scfunc);
+	while (functable[slot] != NULL && functable[slot]->scfunc != f->scfunc)
+	    slot = (slot + 1) & (functable_size - 1);
+
+	if (functable[slot] == NULL)
+	    functable[slot] = f;
+    }
+}
+
+/* Return the first shortcut in the given menu that is bound to the
+ * given keystroke, or NULL when there is none. */
+const sc *lookup_shortcut(int menu, int seq, bool meta)
+{
+    const sc *s;
+
+    if (menu == 0)
+	return NULL;
+
+    /* Without a table, walk the list. */
+    if (keytable == NULL) {
+	for (s = sclist; s != NULL; s = s->next)
+	    if ((s->menus & menu) && seq == s->seq &&
+			meta == (s->type == META))
+		return s;
+
+	return NULL;
+    } else {
+	const sc **table = keytable + menu_index(menu) * keytable_size;
+	size_t slot = keytable_hash(seq, meta);
+
+	while ((s = table[slot]) != NULL) {
+	    if (s->seq == seq && (s->type == META) == meta)
+		return s;
+	    slot = (slot + 1) & (keytable_size - 1);
+	}
+
+	return NULL;
+    }
+}
+
+/* Return the item in the list of functions that belongs to the given
+ * shortcut. */
 const subnfunc *sctofunc(const sc *s)
 {
-    subnfunc *f = allfuncs;
+    const subnfunc *f;
+
+    /* Without a table, walk the list. */
+    if (functable == NULL) {
+	f = allfuncs;
+
+	while (f != NULL && f->scfunc != s->scfunc)
+	    f = f->next;
+    } else {
+	size_t slot = functable_hash(s->scfunc);
 
-    while (f != NULL && f->scfunc != s->scfunc)
-	f = f->next;
+	while ((f = functable[slot]) != NULL && f->scfunc != s->scfunc)
+	    slot = (slot + 1) & (functable_size - 1);
+    }
 
     return f;
 }
@@ -1723,7 +1907,10 @@ void thanks_for_all_the_fish(void)
     /* Free the search and replace history lists. */
     free_filestruct(searchage);
     free_filestruct(replaceage);
+    free_history_indexes();
 #endif
+    /* Free the dispatch tables. */
+    discard_shortcut_tables();
     /* Free the list of functions. */
     while (allfuncs != NULL) {
 	subnfunc *f = allfuncs;
@@ -1739,5 +1926,13 @@ void thanks_for_all_the_fish(void)
 #ifndef DISABLE_NANORC
     free(homedir);
 #endif
+#ifdef ENABLE_UTF8
+    /* Free what was looked up about characters. */
+    free_char_table();
+#endif
+#ifndef DISABLE_TABCOMP
+    /* Free the names that were read for tab completion. */
+    free_completions();
+#endif
 }
 #endif /* DEBUG */
@@ -79,7 +79,7 @@ void do_page_up(void)
 	openfile->current = openfile->current->prev;
 #ifndef NANO_TINY
 	if (ISSET(SOFTWRAP) && openfile->current) {
-	    skipped += strlenpt(openfile->current->data) / COLS;
+	    skipped += line_width(openfile->current) / COLS;
 #ifdef DEBUG
 	    fprintf(stderr, "do_page_up: i = %d, skipped = %d based on line %ld len %lu\n",
 			i, skipped, (long)openfile->current->lineno, (unsigned long)strlenpt(openfile->current->data));
@@ -88,7 +88,7 @@ void do_page_up(void)
 #endif
     }
 
-    openfile->current_x = actual_x(openfile->current->data,
+    openfile->current_x = line_actual_x(openfile->current,
 	openfile->placewewant);
 
 #ifdef DEBUG
@@ -133,7 +133,7 @@ void do_page_down(void)
 
     }
 
-    openfile->current_x = actual_x(openfile->current->data,
+    openfile->current_x = line_actual_x(openfile->current,
 	openfile->placewewant);
 
     /* Scroll the edit window down a page. */
@@ -364,7 +364,7 @@ void do_end(void)
 {
     size_t pww_save = openfile->placewewant;
 
-    openfile->current_x = strlen(openfile->current->data);
+    openfile->current_x = line_length(openfile->current);
     openfile->placewewant = xplustabs();
 
     if (need_screen_update(pww_save))
@@ -394,7 +394,7 @@ void do_up(
 
     /* Move the current line of the edit window up. */
     openfile->current = openfile->current->prev;
-    openfile->current_x = actual_x(openfile->current->data,
+    openfile->current_x = line_actual_x(openfile->current,
 	openfile->placewewant);
 
     /* If scroll_only is FALSE and if we're on the first line of the
@@ -467,18 +467,18 @@ void do_down(
 
     /* Move the current line of the edit window down. */
     openfile->current = openfile->current->next;
-    openfile->current_x = actual_x(openfile->current->data,
+    openfile->current_x = line_actual_x(openfile->current,
 	openfile->placewewant);
 
 #ifndef NANO_TINY
     if (ISSET(SOFTWRAP)) {
 	/* Compute the amount to scroll. */
-	amount = (strlenpt(openfile->current->data) / COLS + openfile->current_y + 2
-		 + strlenpt(openfile->current->prev->data) / COLS - editwinrows);
+	amount = (line_width(openfile->current) / COLS + openfile->current_y + 2
+		 + line_width(openfile->current->prev) / COLS - editwinrows);
 	topline = openfile->edittop;
 	/* Reduce the amount when there are overlong lines at the top. */
 	for (enough = 1; enough < amount; enough++) {
-	    amount -= strlenpt(topline->data) / COLS;
+	    amount -= line_width(topline) / COLS;
 	    if (amount <= 0) {
 		amount = enough;
 		break;
@@ -552,7 +552,7 @@ void do_left(void)
 		openfile->current_x);
     else if (openfile->current != openfile->fileage) {
 	do_up_void();
-	openfile->current_x = strlen(openfile->current->data);
+	openfile->current_x = line_length(openfile->current);
     }
 
     openfile->placewewant = xplustabs();
@@ -35,6 +35,7 @@
 #include <langinfo.h>
 #endif
 #include <termios.h>
+#include <poll.h>
 #ifdef HAVE_GETOPT_H
 #include <getopt.h>
 #endif
@@ -54,6 +55,12 @@ static struct termios oldterm;
 	/* The user's original terminal settings. */
 static struct sigaction act;
 	/* Used to set up all our fun signal handlers. */
+static int pager_fd = -1;
+	/* The descriptor from which stdin is still being read in while
+	 * editing, or -1 when it isn't. */
+static feedstruct pager_feed;
+	/* The buffer into which stdin is being read, and its last,
+	 * incomplete line. */
 
 /* Create a new filestruct node.  Note that we do not set prevnode->next
  * to the new line. */
@@ -69,6 +76,10 @@ filestruct *make_new_node(filestruct *prevnode)
 #ifndef DISABLE_COLOR
     newnode->multidata = NULL;
 #endif
+#ifndef NANO_TINY
+    newnode->width = (size_t)-1;
+    newnode->chunks = NULL;
+#endif
 
     return newnode;
 }
@@ -89,6 +100,10 @@ filestruct *copy_node(const filestruct *src)
 #ifndef DISABLE_COLOR
     dst->multidata = NULL;
 #endif
+#ifndef NANO_TINY
+    dst->width = (size_t)-1;
+    dst->chunks = NULL;
+#endif
 
     return dst;
 }
@@ -134,6 +149,9 @@ void delete_node(filestruct *fileptr)
     free(fileptr->data);
 #ifndef DISABLE_COLOR
     free(fileptr->multidata);
+#endif
+#ifndef NANO_TINY
+    free_chunks(fileptr->chunks);
 #endif
     free(fileptr);
 }
@@ -205,6 +223,10 @@ partition *partition_filestruct(filestruct *top, size_t top_x,
     /* Initialize the partition. */
     p = (partition *)nmalloc(sizeof(partition));
 
+#ifndef NANO_TINY
+    edit_stamp++;
+#endif
+
     /* If the top and bottom of the partition are different from the top
      * and bottom of the filestruct, save the latter and then set them
      * to top and bot. */
@@ -254,6 +276,10 @@ void unpartition_filestruct(partition **p)
 
     assert(p != NULL && openfile->fileage != NULL && openfile->filebot != NULL);
 
+#ifndef NANO_TINY
+    edit_stamp++;
+#endif
+
     /* Reattach the line above the top of the partition, and restore the
      * text before top_x from top_data.  Free top_data when we're done
      * with it. */
@@ -381,6 +407,10 @@ void move_to_filestruct(filestruct **file_top, filestruct **file_bot,
 #ifndef DISABLE_COLOR
     openfile->fileage->multidata = NULL;
 #endif
+#ifndef NANO_TINY
+    openfile->fileage->width = (size_t)-1;
+    openfile->fileage->chunks = NULL;
+#endif
 
     /* Restore the current line and cursor position.  If the mark begins
      * inside the partition, set the beginning of the mark to where the
@@ -531,6 +561,13 @@ void unlink_opennode(openfilestruct *fileptr)
     assert(fileptr != NULL && fileptr->prev != NULL && fileptr->next != NULL &&
 		 fileptr != fileptr->prev && fileptr != fileptr->next);
 
+#ifndef DISABLE_FOLLOW
+    stop_following(fileptr);
+#endif
+#ifndef DISABLE_COLOR
+    forget_linter(fileptr);
+#endif
+
     fileptr->prev->next = fileptr->next;
     fileptr->next->prev = fileptr->prev;
 
@@ -542,6 +579,13 @@ void delete_opennode(openfilestruct *fileptr)
 {
     assert(fileptr != NULL && fileptr->filename != NULL && fileptr->fileage != NULL);
 
+    /* Whatever still comes in on stdin has nowhere to go anymore. */
+    if (fileptr == pager_feed.buffer)
+	end_stdin_pager(FALSE);
+#ifndef NANO_TINY
+    forget_command(fileptr);
+#endif
+
     free(fileptr->filename);
     free_filestruct(fileptr->fileage);
 #ifndef NANO_TINY
@@ -549,6 +593,9 @@ void delete_opennode(openfilestruct *fileptr)
     free(fileptr->lock_filename);
     /* Free the undo stack. */
     discard_until(NULL, fileptr);
+#endif
+#ifndef DISABLE_FOLLOW
+    free(fileptr->follow);
 #endif
     free(fileptr);
 }
@@ -559,6 +606,22 @@ void print_view_warning(void)
     statusbar(_("Key is invalid in view mode"));
 }
 
+/* Return TRUE when the current buffer may not be changed: in view mode,
+ * while it is still being read in from stdin or the output of a command
+ * is coming into it, or when its file is being followed. */
+bool in_view_mode(void)
+{
+#ifndef DISABLE_FOLLOW
+    if (openfile->follow != NULL)
+	return TRUE;
+#endif
+#ifndef NANO_TINY
+    if (running_command())
+	return TRUE;
+#endif
+    return (ISSET(VIEW_MODE) || reading_stdin());
+}
+
 /* Indicate that something is disabled in restricted mode. */
 void show_restricted_warning(void)
 {
@@ -582,11 +645,19 @@ void finish(void)
     blank_statusbar();
     blank_bottombars();
     wrefresh(bottomwin);
+#ifndef NANO_TINY
+    set_bracketed_paste(FALSE);
+#endif
     endwin();
 
     /* Restore the old terminal settings. */
     tcsetattr(0, TCSANOW, &oldterm);
 
+#ifndef DISABLE_COLOR
+    /* Don't leave a linter running behind. */
+    cancel_linter();
+#endif
+
 #ifndef DISABLE_HISTORIES
     if (ISSET(HISTORYLOG))
 	save_history();
@@ -609,6 +680,9 @@ void die(const char *msg, ...)
 {
     va_list ap;
 
+#ifndef NANO_TINY
+    set_bracketed_paste(FALSE);
+#endif
     endwin();
 
     /* Restore the old terminal settings. */
@@ -922,6 +996,9 @@ void usage(void)
     print_opt("-w", "--nowrap", N_("Don't hard-wrap long lines"));
 #endif
     print_opt("-x", "--nohelp", N_("Don't show the two help lines"));
+#ifndef DISABLE_FOLLOW
+    print_opt("-y", "--follow", N_("Follow growing files, like tail -f"));
+#endif
     if (!ISSET(RESTRICTED))
 	print_opt("-z", "--suspend", N_("Enable suspension"));
 #ifndef NANO_TINY
@@ -1157,12 +1234,20 @@ void finish_stdin_pager(void)
     FILE *f;
     int ttystdin;
 
-    /* Read whatever we did get from stdin. */
-    f = fopen("/dev/stdin", "rb");
-    if (f == NULL)
-	nperror("fopen");
+    /* Read whatever we did get from stdin -- unless it is going to be
+     * read in while editing. */
+    if (pager_fd == -1) {
+	f = fopen("/dev/stdin", "rb");
+	if (f == NULL)
+	    nperror("fopen");
+
+	read_file(f, 0, "stdin", TRUE, FALSE);
+    } else {
+	memset(&pager_feed, 0, sizeof(feedstruct));
+	pager_feed.buffer = openfile;
+	pager_feed.keep_top = TRUE;
+    }
 
-    read_file(f, 0, "stdin", TRUE, FALSE);
     ttystdin = open("/dev/tty", O_RDONLY);
     if (!ttystdin)
 	die(_("Couldn't reopen stdin from keyboard, sorry\n"));
@@ -1175,6 +1260,9 @@ void finish_stdin_pager(void)
 	nperror("sigaction");
     terminal_init();
     doupdate();
+
+    if (pager_fd != -1)
+	statusbar(_("Reading from stdin, ^C to stop"));
 }
 
 /* Cancel reading from stdin like a pager. */
@@ -1189,7 +1277,20 @@ void stdin_pager(void)
     endwin();
     if (!pager_input_aborted)
 	tcsetattr(0, TCSANOW, &oldterm);
-    fprintf(stderr, _("Reading from stdin, ^C to abort\n"));
+
+    /* When stdin is a pipe or a file, it is read in gradually while the
+     * user can already look at what has arrived; when it's the terminal,
+     * it has to be read in completely first. */
+    if (!isatty(0))
+	pager_fd = dup(0);
+    if (pager_fd != -1 && fcntl(pager_fd, F_SETFL,
+		fcntl(pager_fd, F_GETFL) | O_NONBLOCK) == -1) {
+	close(pager_fd);
+	pager_fd = -1;
+    }
+
+    if (pager_fd == -1)
+	fprintf(stderr, _("Reading from stdin, ^C to abort\n"));
 
     /* Enable interpretation of the special control keys so that
      * we get SIGINT when Ctrl-C is pressed. */
@@ -1213,6 +1314,230 @@ void stdin_pager(void)
     finish_stdin_pager();
 }
 
+/* Stop reading from stdin.  When done is TRUE, the last, unterminated
+ * line is added to the buffer and the number of lines is reported (when
+ * no prompt is showing), as read_file() would do; otherwise the buffer
+ * is about to disappear. */
+void end_stdin_pager(bool done)
+{
+    if (done) {
+	finish_feed(&pager_feed);
+
+#ifndef NANO_TINY
+	set_feed_format(pager_feed.buffer, pager_feed.format);
+#endif
+
+	if (currmenu == MMAIN)
+	    report_feed(&pager_feed);
+    } else
+	free(pager_feed.line);
+
+    close(pager_fd);
+    pager_fd = -1;
+    pager_feed.buffer = NULL;
+}
+
+/* Read in whatever has arrived on stdin, up to STDIN_BATCH bytes at a
+ * time, so that keystrokes don't have to wait long. */
+void read_more_stdin(void)
+{
+    char chunk[BUFSIZ * 8];
+    size_t total = 0;
+    ssize_t got = 0;
+
+    while (total < STDIN_BATCH) {
+	got = read(pager_fd, chunk, sizeof(chunk));
+
+	if (got <= 0)
+	    break;
+
+	feed_text(&pager_feed, chunk, got);
+	total += got;
+    }
+
+    if (got == 0)
+	end_stdin_pager(TRUE);
+    else if (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+		errno != EINTR) {
+	statusbar(_("Error reading %s: %s"), "stdin", strerror(errno));
+	end_stdin_pager(TRUE);
+    }
+}
+
+/* Return TRUE when the current buffer is still being read from stdin. */
+bool reading_stdin(void)
+{
+    return (pager_fd != -1 && openfile == pager_feed.buffer);
+}
+
+/* Wait until there is keyboard input, meanwhile reading in whatever
+ * arrives on stdin, gets appended to a followed file or is output by an
+ * executed command, and showing it when it lands in the visible part of
+ * the current buffer, feeding the command its input, taking in what a
+ * background linter reports, and showing what the file browser finds
+ * out about its files.  Return FALSE when the wait got interrupted by
+ * a signal. */
+bool wait_for_keystroke(void)
+{
+    struct pollfd fds[8];
+
+    while (pager_fd != -1
+#ifndef NANO_TINY
+		|| command_fd != -1 || command_input_fd != -1
+		|| command_lingers()
+#endif
+#ifndef DISABLE_FOLLOW
+		|| follow_fd != -1
+#endif
+#ifndef DISABLE_COLOR
+		|| lint_fd != -1 || linter_lingers()
+#endif
+#ifdef USE_PREFETCH
+		|| prefetch_fd != -1
+#endif
+#ifdef USE_DIRWATCH
+		|| browser_watch_fd != -1
+#endif
+		) {
+	int timeout = -1;
+	    /* How long to wait for something to happen, in milliseconds. */
+
+#ifndef DISABLE_COLOR
+	/* A process that lingers after its output has ended must be
+	 * checked on every so often. */
+	if (linter_lingers())
+	    timeout = REAP_INTERVAL;
+#endif
+#ifndef NANO_TINY
+	if (command_lingers())
+	    timeout = REAP_INTERVAL;
+#endif
+
+	/* Negative descriptors are ignored by poll(). */
+	fds[0].fd = 0;
+	fds[0].events = POLLIN;
+	fds[1].fd = pager_fd;
+	fds[1].events = POLLIN;
+#ifndef DISABLE_FOLLOW
+	fds[2].fd = follow_fd;
+#else
+	fds[2].fd = -1;
+#endif
+	fds[2].events = POLLIN;
+#ifndef DISABLE_COLOR
+	fds[3].fd = lint_fd;
+#else
+	fds[3].fd = -1;
+#endif
+	fds[3].events = POLLIN;
+#ifdef USE_PREFETCH
+	fds[4].fd = prefetch_fd;
+#else
+	fds[4].fd = -1;
+#endif
+	fds[4].events = POLLIN;
+#ifdef USE_DIRWATCH
+	fds[5].fd = browser_watch_fd;
+#else
+	fds[5].fd = -1;
+#endif
+	fds[5].events = POLLIN;
+#ifndef NANO_TINY
+	fds[6].fd = command_fd;
+	fds[7].fd = command_input_fd;
+#else
+	fds[6].fd = -1;
+	fds[7].fd = -1;
+#endif
+	fds[6].events = POLLIN;
+	fds[7].events = POLLOUT;
+
+	if (poll(fds, 8, timeout) == -1) {
+#ifndef NANO_TINY
+	    number_command_output();
+#endif
+	    return (errno != EINTR);
+	}
+
+#ifndef NANO_TINY
+	if (fds[7].revents != 0)
+	    handle_command_input();
+
+	if (fds[6].revents != 0) {
+	    if (handle_command_output() && currmenu == MMAIN)
+		edit_refresh();
+
+	    doupdate();
+	}
+
+	reap_command();
+#endif
+
+#ifdef USE_DIRWATCH
+	if (fds[5].revents != 0) {
+	    if (handle_browser_events() && currmenu == MBROWSER)
+		browser_refresh();
+
+	    doupdate();
+	}
+#endif
+
+#ifdef USE_PREFETCH
+	if (fds[4].revents != 0) {
+	    handle_prefetch_results();
+
+	    if (currmenu == MBROWSER)
+		browser_refresh();
+
+	    doupdate();
+	}
+#endif
+
+#ifndef DISABLE_COLOR
+	if (fds[3].revents != 0) {
+	    handle_lint_output();
+	    doupdate();
+	} else if (linter_lingers()) {
+	    reap_linter();
+	    doupdate();
+	}
+#endif
+
+#ifndef DISABLE_FOLLOW
+	if (fds[2].revents != 0) {
+	    if (handle_follow_events() && currmenu == MMAIN)
+		edit_refresh();
+
+	    doupdate();
+	}
+#endif
+
+	if (fds[1].revents != 0) {
+	    bool onscreen = reading_stdin() && openfile->filebot->lineno <
+			openfile->edittop->lineno + editwinrows;
+
+	    read_more_stdin();
+
+	    /* Only redraw when in the edit window itself, not when at
+	     * a prompt or in the help viewer or file browser. */
+	    if (onscreen && currmenu == MMAIN)
+		edit_refresh();
+
+	    doupdate();
+	}
+
+	if (fds[0].revents != 0)
+	    break;
+    }
+
+#ifndef NANO_TINY
+    /* Whatever the keystroke does, it may look at line numbers. */
+    number_command_output();
+#endif
+
+    return TRUE;
+}
+
 /* Initialize the signal handlers. */
 void signal_init(void)
 {
@@ -1266,6 +1591,9 @@ RETSIGTYPE do_suspend(int signal)
 
     /* Move the cursor to the last line of the screen. */
     move(LINES - 1, 0);
+#ifndef NANO_TINY
+    set_bracketed_paste(FALSE);
+#endif
     endwin();
 
     /* Display our helpful message. */
@@ -1553,8 +1881,78 @@ void terminal_init(void)
     } else
 	tcsetattr(0, TCSANOW, &newterm);
 #endif
+
+#ifndef NANO_TINY
+    set_bracketed_paste(TRUE);
+#endif
+}
+
+#ifndef NANO_TINY
+/* Tell the terminal whether to mark pasted text with escape sequences,
+ * so that we can tell a paste apart from typing. */
+void set_bracketed_paste(bool on)
+{
+    printf(on ? "\033[?2004h" : "\033[?2004l");
+    fflush(stdout);
 }
 
+/* Read in the text of a bracketed paste, and insert it into the buffer
+ * in one go, as a single undoable action.  Since nothing of it is typed,
+ * the pasted tabs and newlines don't cause autoindenting or wrapping. */
+void do_bracketed_paste(void)
+{
+    filestruct *was_cutbuffer = cutbuffer, *was_cutbottom = cutbottom;
+    size_t paste_len, i = 0;
+    char *paste = get_bracketed_paste(&paste_len);
+
+    if (paste_len == 0 || in_view_mode()) {
+	if (paste_len > 0)
+	    print_view_warning();
+	free(paste);
+	return;
+    }
+
+    /* Split the pasted text into lines, in a private cutbuffer, dropping
+     * any control characters except tabs.  Terminals send a carriage
+     * return for each line break; take a CR LF pair as a single one. */
+    cutbuffer = make_new_node(NULL);
+    cutbottom = cutbuffer;
+
+    while (TRUE) {
+	size_t line_len = 0, j;
+
+	for (j = i; j < paste_len && paste[j] != '\r' &&
+		paste[j] != '\n'; j++)
+	    ;
+
+	cutbottom->data = charalloc(j - i + 1);
+
+	for (; i < j; i++)
+	    if (!is_ascii_cntrl_char(paste[i]) || paste[i] == '\t')
+		cutbottom->data[line_len++] = paste[i];
+	cutbottom->data[line_len] = '\0';
+
+	if (i == paste_len)
+	    break;
+
+	if (paste[i] == '\r' && i + 1 < paste_len && paste[i + 1] == '\n')
+	    i++;
+	i++;
+
+	cutbottom->next = make_new_node(cutbottom);
+	cutbottom = cutbottom->next;
+    }
+
+    free(paste);
+
+    do_uncut_text();
+
+    free_filestruct(cutbuffer);
+    cutbuffer = was_cutbuffer;
+    cutbottom = was_cutbottom;
+}
+#endif /* !NANO_TINY */
+
 /* Read in a character, interpret it as a shortcut or toggle if
  * necessary, and return it.
  * If allow_funcs is FALSE, don't actually run any functions associated
@@ -1571,6 +1969,8 @@ int do_input(bool allow_funcs)
 	/* Preserve the contents of the cutbuffer? */
     const sc *s;
     bool have_shortcut;
+    bool pasting = FALSE;
+	/* Did we get the start of a bracketed paste? */
 
     /* Read in a character. */
     input = get_kbinput(edit);
@@ -1580,6 +1980,23 @@ int do_input(bool allow_funcs)
 	return KEY_WINCH;
 #endif
 
+    /* While stdin is still being read in, ^C stops the reading. */
+    if (input == NANO_CONTROL_C && pager_fd != -1 && !meta_key &&
+		!func_key) {
+	end_stdin_pager(TRUE);
+	return ERR;
+    }
+
+#ifndef NANO_TINY
+    /* While the output of a command comes in, ^C kills the command. */
+    if (input == NANO_CONTROL_C && running_command() && !meta_key &&
+		!func_key) {
+	stop_command();
+	edit_refresh();
+	return ERR;
+    }
+#endif
+
 #ifndef DISABLE_MOUSE
     if (func_key && input == KEY_MOUSE) {
 	/* We received a mouse click. */
@@ -1593,6 +2010,18 @@ int do_input(bool allow_funcs)
     }
 #endif
 
+#ifndef NANO_TINY
+    /* A stray end-of-paste marker means nothing. */
+    if (input == END_OF_PASTE)
+	return ERR;
+
+    if (input == START_OF_PASTE) {
+	if (!allow_funcs)
+	    return input;
+	pasting = TRUE;
+    }
+#endif
+
     /* Check for a shortcut in the main list. */
     s = get_shortcut(&input);
 
@@ -1602,7 +2031,7 @@ int do_input(bool allow_funcs)
 
     /* If we got a non-high-bit control key, a meta key sequence, or a
      * function key, and it's not a shortcut or toggle, throw it out. */
-    if (!have_shortcut) {
+    if (!have_shortcut && !pasting) {
 	if (is_ascii_cntrl_char(input) || meta_key || func_key) {
 	    statusbar(_("Unknown Command"));
 	    beep();
@@ -1617,8 +2046,8 @@ int do_input(bool allow_funcs)
 	 * it's a normal text character.  Display the warning if we're
 	 * in view mode, or add the character to the input buffer if
 	 * we're not. */
-	if (input != ERR && !have_shortcut) {
-	    if (ISSET(VIEW_MODE))
+	if (input != ERR && !have_shortcut && !pasting) {
+	    if (in_view_mode())
 		print_view_warning();
 	    else {
 		kbinput_len++;
@@ -1633,11 +2062,11 @@ int do_input(bool allow_funcs)
 	 * output all the characters in the input buffer if it isn't
 	 * empty.  Note that it should be empty if we're in view
 	 * mode. */
-	if (have_shortcut || get_key_buffer_len() == 0) {
+	if (have_shortcut || pasting || get_key_buffer_len() == 0) {
 #ifndef DISABLE_WRAPPING
 	    /* If we got a shortcut or toggle, and it's not the shortcut
 	     * for verbatim input, turn off prepending of wrapped text. */
-	    if (have_shortcut && s->scfunc != do_verbatim_input)
+	    if ((have_shortcut && s->scfunc != do_verbatim_input) || pasting)
 		wrap_reset();
 #endif
 
@@ -1662,6 +2091,17 @@ int do_input(bool allow_funcs)
 	    }
 	}
 
+#ifndef NANO_TINY
+	if (pasting) {
+	    do_bracketed_paste();
+
+	    if (edit_refresh_needed) {
+		edit_refresh();
+		edit_refresh_needed = FALSE;
+	    }
+	}
+#endif
+
 	if (have_shortcut) {
 	    const subnfunc *f = sctofunc(s);
 	    /* If the function associated with this shortcut is
@@ -1677,7 +2117,7 @@ int do_input(bool allow_funcs)
 		statusbar("Internal error: shortcut without function!");
 		return ERR;
 	    }
-	    if (ISSET(VIEW_MODE) && f && !f->viewok)
+	    if (in_view_mode() && f && !f->viewok)
 		print_view_warning();
 	    else {
 #ifndef NANO_TINY
@@ -1761,7 +2201,7 @@ int do_mouse(void)
 		 openfile->current->next && i < mouse_y;
 		 openfile->current = openfile->current->next, i++) {
 		openfile->current_y = i;
-		i += strlenpt(openfile->current->data) / COLS;
+		i += line_width(openfile->current) / COLS;
 	    }
 #ifdef DEBUG
 	    fprintf(stderr, "do_mouse(): moving to current_y = %ld, index i = %lu\n",
@@ -1771,13 +2211,13 @@ int do_mouse(void)
 
 	    if (i > mouse_y) {
 		openfile->current = openfile->current->prev;
-		openfile->current_x = actual_x(openfile->current->data, mouse_x + (mouse_y - openfile->current_y) * COLS);
+		openfile->current_x = line_actual_x(openfile->current, mouse_x + (mouse_y - openfile->current_y) * COLS);
 #ifdef DEBUG
 		fprintf(stderr, "do_mouse(): i > mouse_y, mouse_x = %d, current_x to = %lu\n",
 			mouse_x, (unsigned long)openfile->current_x);
 #endif
 	    } else {
-		openfile->current_x = actual_x(openfile->current->data, mouse_x);
+		openfile->current_x = line_actual_x(openfile->current, mouse_x);
 #ifdef DEBUG
 		fprintf(stderr, "do_mouse(): i <= mouse_y, mouse_x = %d, setting current_x to = %lu\n",
 			mouse_x, (unsigned long)openfile->current_x);
@@ -1794,7 +2234,7 @@ int do_mouse(void)
 		   openfile->fileage; openfile->current_y--)
 		openfile->current = openfile->current->prev;
 
-	    openfile->current_x = actual_x(openfile->current->data,
+	    openfile->current_x = line_actual_x(openfile->current,
 		get_page_start(xplustabs()) + mouse_x);
 	}
 
@@ -1819,12 +2259,39 @@ int do_mouse(void)
 }
 #endif /* !DISABLE_MOUSE */
 
+/* Close up what is left of the room that do_output() reserved in the
+ * current line at current_x, and bring the index of the line up to
+ * date with the run of text that was put in starting at run_x. */
+static void close_room(size_t *room, size_t current_len, size_t run_x,
+	size_t run_stamp)
+{
+    char *gap = openfile->current->data + openfile->current_x;
+
+    if (*room > 0)
+	charmove(gap, gap + *room, current_len - openfile->current_x + 1);
+    *room = 0;
+
+#ifndef NANO_TINY
+    update_chunks(openfile->current, run_stamp, run_x, 0,
+	openfile->current_x - run_x);
+#endif
+}
+
 /* The user typed output_len multibyte characters.  Add them to the edit
  * buffer, filtering out all ASCII control characters if allow_cntrls is
  * TRUE. */
 void do_output(char *output, size_t output_len, bool allow_cntrls)
 {
     size_t current_len, i = 0;
+    size_t room = 0;
+	/* How many bytes are still reserved in the line at current_x. */
+    bool wrapping = FALSE;
+	/* Whether each character may cause the line to be wrapped. */
+    size_t run_x = 0;
+	/* Where the run of text that goes into the line begins. */
+    size_t run_stamp = (size_t)-1;
+	/* The edit stamp at which the index of the line was current
+	 * before the run, if it was. */
 #ifndef NANO_TINY
     size_t orig_lenpt = 0;
 #endif
@@ -1834,11 +2301,15 @@ void do_output(char *output, size_t output_len, bool allow_cntrls)
 
     assert(openfile->current != NULL && openfile->current->data != NULL);
 
-    current_len = strlen(openfile->current->data);
+    current_len = line_length(openfile->current);
 
 #ifndef NANO_TINY
     if (ISSET(SOFTWRAP))
-	orig_lenpt = strlenpt(openfile->current->data);
+	orig_lenpt = line_width(openfile->current);
+#endif
+
+#ifndef DISABLE_WRAPPING
+    wrapping = !ISSET(NO_WRAP);
 #endif
 
     while (i < output_len) {
@@ -1849,7 +2320,9 @@ void do_output(char *output, size_t output_len, bool allow_cntrls)
 		output[i] = '\n';
 	    /* Newline to Enter, if needed. */
 	    else if (output[i] == '\n') {
+		close_room(&room, current_len, run_x, run_stamp);
 		do_enter();
+		current_len = strlen(openfile->current->data);
 		i++;
 		continue;
 	    }
@@ -1869,17 +2342,37 @@ void do_output(char *output, size_t output_len, bool allow_cntrls)
 	if (!ISSET(NO_NEWLINES) && openfile->filebot == openfile->current)
 	    new_magicline();
 
-	/* More dangerousness fun =) */
-	openfile->current->data = charealloc(openfile->current->data,
-					current_len + (char_buf_len * 2));
-
 	assert(openfile->current_x <= current_len);
 
-	charmove(openfile->current->data + openfile->current_x + char_buf_len,
+	/* Make room for the character.  When no character can cause a
+	 * wrap, make room for the whole run up to the next newline at
+	 * once, so that the rest of the line gets moved only once. */
+	if (room == 0) {
+	    size_t span = char_buf_len;
+
+	    if (!wrapping) {
+		const char *newline = allow_cntrls ? memchr(output + i,
+			'\n', output_len - i) : NULL;
+
+		span += (newline != NULL ? newline - output : output_len) - i;
+	    }
+
+	    run_x = openfile->current_x;
+#ifndef NANO_TINY
+	    if (!wrapping && chunks_current(openfile->current))
+		run_stamp = edit_stamp;
+#endif
+	    openfile->current->data = charealloc(openfile->current->data,
+					current_len + span + 1);
+	    charmove(openfile->current->data + openfile->current_x + span,
 			openfile->current->data + openfile->current_x,
-			current_len - openfile->current_x + char_buf_len);
+			current_len - openfile->current_x + 1);
+	    room = span;
+	}
+
 	strncpy(openfile->current->data + openfile->current_x, char_buf,
 		char_buf_len);
+	room -= char_buf_len;
 	current_len += char_buf_len;
 	openfile->totsize++;
 	set_modified();
@@ -1901,17 +2394,21 @@ void do_output(char *output, size_t output_len, bool allow_cntrls)
 
 #ifndef DISABLE_WRAPPING
 	/* If we're wrapping text, we need to call edit_refresh(). */
-	if (!ISSET(NO_WRAP))
+	if (wrapping) {
 	    if (do_wrap(openfile->current))
 		edit_refresh_needed = TRUE;
+	    current_len = strlen(openfile->current->data);
+	}
 #endif
     }
 
+    close_room(&room, current_len, run_x, run_stamp);
+
 #ifndef NANO_TINY
     /* Well, we might also need a full refresh if we've changed the
      * line length to be a new multiple of COLS. */
     if (ISSET(SOFTWRAP) && edit_refresh_needed == FALSE)
-	if (strlenpt(openfile->current->data) / COLS != orig_lenpt / COLS)
+	if (line_width(openfile->current) / COLS != orig_lenpt / COLS)
 	    edit_refresh_needed = TRUE;
 #endif
 
@@ -1991,6 +2488,9 @@ int main(int argc, char **argv)
 	{"nowrap", 0, NULL, 'w'},
 #endif
 	{"nohelp", 0, NULL, 'x'},
+#ifndef DISABLE_FOLLOW
+	{"follow", 0, NULL, 'y'},
+#endif
 	{"suspend", 0, NULL, 'z'},
 #ifndef NANO_TINY
 	{"smarthome", 0, NULL, 'A'},
@@ -2047,11 +2547,11 @@ int main(int argc, char **argv)
     while ((optchr =
 #ifdef HAVE_GETOPT_LONG
 	getopt_long(argc, argv,
-		"ABC:DEFGHIKLNOPQ:RST:UVWY:abcdefghijklmno:pqr:s:tuvwxz$",
+		"ABC:DEFGHIKLNOPQ:RST:UVWY:abcdefghijklmno:pqr:s:tuvwxyz$",
 		long_options, NULL)
 #else
 	getopt(argc, argv,
-		"ABC:DEFGHIKLNOPQ:RST:UVWY:abcdefghijklmno:pqr:s:tuvwxz$")
+		"ABC:DEFGHIKLNOPQ:RST:UVWY:abcdefghijklmno:pqr:s:tuvwxyz$")
 #endif
 		) != -1) {
 	switch (optchr) {
@@ -2232,6 +2732,11 @@ int main(int argc, char **argv)
 	    case 'x':
 		SET(NO_HELP);
 		break;
+#ifndef DISABLE_FOLLOW
+	    case 'y':
+		SET(FOLLOW_MODE);
+		break;
+#endif
 	    case 'z':
 		SET(SUSPEND);
 		break;
@@ -112,13 +112,23 @@
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <dirent.h>
+#ifndef DISABLE_FOLLOW
+#include <sys/inotify.h>
+#endif
 #ifdef HAVE_REGEX_H
 #include <regex.h>
 #endif
 #include <signal.h>
 #include <assert.h>
 
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_LIBPTHREAD)
+/* Some counting can be spread over several threads. */
+#define USE_THREADS 1
+#include <pthread.h>
+#endif
+
 /* If no vsnprintf(), use the version from glib 2.x. */
 #ifndef HAVE_VSNPRINTF
 #include <glib.h>
@@ -163,6 +173,20 @@
 #define DISABLE_WRAPJUSTIFY 1
 #endif
 
+/* Following files as they grow requires inotify. */
+#if defined(NANO_TINY) || !defined(HAVE_SYS_INOTIFY_H)
+#define DISABLE_FOLLOW 1
+#endif
+
+/* The file browser can look up files in the background, and notice
+ * when they change. */
+#if !defined(DISABLE_BROWSER) && defined(USE_THREADS)
+#define USE_PREFETCH 1
+#endif
+#if !defined(DISABLE_BROWSER) && !defined(DISABLE_FOLLOW)
+#define USE_DIRWATCH 1
+#endif
+
 /* Enumeration types. */
 typedef enum {
     NIX_FILE, DOS_FILE, MAC_FILE
@@ -189,7 +213,7 @@ typedef enum {
 #ifndef DISABLE_WRAPPING
     SPLIT_BEGIN, SPLIT_END,
 #endif
-    JOIN, PASTE, INSERT, ENTER, OTHER
+    FILTER_BEGIN, FILTER_END, JOIN, PASTE, INSERT, ENTER, OTHER
 } undo_type;
 
 /* Structure types. */
@@ -258,6 +282,35 @@ typedef struct syntaxtype {
 	/* Next syntax. */
 } syntaxtype;
 
+typedef struct syntaxmatch {
+    char *suffix;
+	/* A file extension that selects the syntax, or NULL when the
+	 * regex below can't be reduced to a set of extensions. */
+    regexlisttype *regex;
+	/* The extension regex that this entry stems from. */
+    syntaxtype *syntax;
+	/* The syntax that gets selected. */
+    size_t rank;
+	/* The position of that syntax in the list of syntaxes. */
+} syntaxmatch;
+
+typedef struct cacheentry {
+    const char *start;
+	/* Where this entry starts in the syntax cache. */
+    const char *filename;
+	/* The syntax file whose syntaxes this entry holds. */
+    time_t mtime;
+	/* The modification time of that file when it was cached. */
+    off_t size;
+	/* And its size at that time. */
+    const char *data;
+	/* Where the serialized syntaxes start. */
+    const char *end;
+	/* And where they end. */
+    bool used;
+	/* Whether the entry was used during this run. */
+} cacheentry;
+
 typedef struct lintstruct {
     ssize_t lineno;
 	/* Line number of the error. */
@@ -286,6 +339,38 @@ typedef struct lintstruct {
 	/* Regex starts and ends within this line. */
 #endif /* !DISABLE_COLOR */
 
+#ifndef NANO_TINY
+typedef struct chunkinfo {
+    size_t start;
+	/* Where in the line this chunk begins. */
+    size_t column;
+	/* The column at which this chunk begins. */
+    size_t lead;
+	/* The width of the text before the first tab in this chunk, or of
+	 * all of it when there is no tab. */
+    size_t tail;
+	/* The width of the text after that first tab, when it begins at
+	 * a tab stop. */
+    bool hastab;
+	/* Whether this chunk contains a tab. */
+} chunkinfo;
+
+typedef struct linechunks {
+    const char *data;
+	/* The text of the line when this index was made. */
+    size_t stamp;
+	/* The value of edit_stamp at that time. */
+    size_t len;
+	/* The length of the line. */
+    size_t count;
+	/* The number of chunks. */
+    size_t size;
+	/* The number of chunks there is room for. */
+    chunkinfo *chunk;
+	/* The chunks, in order. */
+} linechunks;
+#endif
+
 /* More structure types. */
 typedef struct filestruct {
     char *data;
@@ -300,6 +385,18 @@ typedef struct filestruct {
     short *multidata;
 	/* Array of which multi-line regexes apply to this line. */
 #endif
+#ifndef NANO_TINY
+    size_t width;
+	/* The display width of this line when it was last measured, or
+	 * (size_t)-1 when it hasn't been measured. */
+    const char *width_data;
+	/* The text of the line at that time. */
+    size_t width_stamp;
+	/* And the value of edit_stamp then. */
+    linechunks *chunks;
+	/* For a very long line, an index of its pieces with their widths,
+	 * or NULL. */
+#endif
 } filestruct;
 
 typedef struct partition {
@@ -404,6 +501,10 @@ typedef struct openfilestruct {
     char *lock_filename;
 	/* The path of the lockfile, if we created one. */
 #endif
+#ifndef DISABLE_FOLLOW
+    struct followstruct *follow;
+	/* How far the file has been read, when it is being followed. */
+#endif
 #ifndef DISABLE_COLOR
     syntaxtype *syntax;
 	/* The  syntax struct for this file, if any. */
@@ -416,6 +517,145 @@ typedef struct openfilestruct {
 	/* The preceding open file, if any. */
 } openfilestruct;
 
+#ifndef DISABLE_FOLLOW
+typedef struct followstruct {
+    int wd;
+	/* The inotify watch on the file, or -1 when it's gone. */
+    int dirwd;
+	/* The watch on its directory, to notice the file reappearing. */
+    dev_t dev;
+	/* The device of the file being read. */
+    ino_t ino;
+	/* And its inode number. */
+    off_t size;
+	/* The number of bytes that have been read from it. */
+    size_t partial;
+	/* How many of these belong to its incomplete last line. */
+    bool magic;
+	/* Whether a magicline was added after that line. */
+    int format;
+	/* 0 = *nix, 1 = DOS, 2 = Mac, 3 = both DOS and Mac. */
+    bool pending;
+	/* Whether an event for the file has come in. */
+} followstruct;
+#endif
+
+typedef struct feedstruct {
+    openfilestruct *buffer;
+	/* The buffer that lines are being added to. */
+    char *line;
+	/* The line that hasn't been completed yet. */
+    size_t len;
+	/* The length of that line. */
+    size_t size;
+	/* The number of bytes allocated for it. */
+    size_t lines;
+	/* The number of lines added so far. */
+    int format;
+	/* 0 = *nix, 1 = DOS, 2 = Mac, 3 = both DOS and Mac. */
+    bool keep_top;
+	/* Whether the view stays at the top when the first line comes. */
+    bool midway;
+	/* Whether the lines go into the middle of the file, where no
+	 * magicline belongs. */
+    filestruct *spot;
+	/* The line where the text goes in, or NULL for the last line. */
+    size_t spot_x;
+	/* The place in that line. */
+} feedstruct;
+
+typedef struct linediff {
+    filestruct **old_lines;
+	/* The lines of the buffer. */
+    char **new_lines;
+	/* The lines of the new text. */
+    size_t *old_hashes, *new_hashes;
+	/* A hash of each line, to quickly tell most lines apart. */
+    bool *old_changed, *new_changed;
+	/* Whether each line is absent from the other side. */
+    ssize_t *forward, *backward;
+	/* The furthest reaching paths per diagonal, in both directions. */
+    size_t budget;
+	/* How many more diagonals may be explored before giving up on
+	 * finding a minimal difference. */
+} linediff;
+
+typedef struct spellword {
+    char *word;
+	/* A word that the spell checker flagged. */
+    size_t keylen;
+	/* The length of its leading run of word characters, the key
+	 * under which it is indexed. */
+    filestruct **lines;
+	/* The lines where that key occurs as a whole word, in order. */
+    size_t count;
+	/* The number of those lines. */
+    size_t size;
+	/* The number of slots allocated for them. */
+    struct spellword *same_key;
+	/* The next flagged word with the same key. */
+} spellword;
+
+#ifndef DISABLE_BROWSER
+typedef struct browserentry {
+    char *path;
+	/* The full path of the file. */
+    bool isdir;
+	/* Whether it's a directory or a link to one, for sorting. */
+    char *blurb;
+	/* What is shown next to the name: "--", "(dir)", or the size;
+	 * NULL as long as the file hasn't been looked at. */
+    bool fresh;
+	/* Whether the blurb describes the file as it was last seen. */
+    bool busy;
+	/* Whether a helper thread is looking at the file right now. */
+    bool touched;
+	/* Whether the file changed while it was being looked at. */
+} browserentry;
+#endif
+
+#ifndef DISABLE_HISTORIES
+typedef struct historyindex {
+    filestruct **table;
+	/* A hash table of the strings in a history list, with open
+	 * addressing; an empty slot is NULL. */
+    size_t size;
+	/* The number of slots in that table; a power of two. */
+    size_t count;
+	/* The number of strings in the list, not counting the blank one
+	 * at its end. */
+    filestruct **sorted;
+	/* The strings in the list in sorted order, for completion. */
+    bool unsorted;
+	/* Whether that order has to be established again. */
+} historyindex;
+#endif
+
+#ifndef DISABLE_TABCOMP
+typedef struct candidate {
+    char *name;
+	/* A filename, or a username. */
+    char *home;
+	/* The home directory of the user; NULL for a file. */
+    signed char isdir;
+	/* For a file: 1 if it's a directory, 0 if it isn't, and -1 if
+	 * that has to be asked each time (for a link, for example). */
+} candidate;
+#endif
+
+#ifndef NANO_TINY
+typedef struct tallystruct {
+    const filestruct *first;
+	/* The first line of a range of lines to be counted. */
+    size_t lines;
+	/* How many lines the range holds. */
+    size_t words;
+	/* The number of words found in them. */
+    size_t chars;
+	/* The number of characters in them, newlines included. */
+} tallystruct;
+#endif
+
 #ifndef DISABLE_NANORC
 typedef struct rcoption {
    const char *name;
@@ -518,7 +758,10 @@ enum
     LOCKING,
     NOREAD_MODE,
     MAKE_IT_UNIX,
-    JUSTIFY_TRIM
+    JUSTIFY_TRIM,
+    ATOMIC_SAVE,
+    FOLLOW_MODE,
+    LINT_ON_SAVE
 };
 
 /* Flags for the menus in which a given function should be present. */
@@ -537,12 +780,15 @@ enum
 #define MGOTODIR		(1<<12)
 #define MYESNO			(1<<13)
 #define MLINTER			(1<<14)
+/* The number of menu flags above. */
+#define NUMBER_OF_MENUS		15
 /* This is an abbreviation for all menus except Help and YesNo. */
 #define MMOST  (MMAIN|MWHEREIS|MREPLACE|MREPLACEWITH|MGOTOLINE|MWRITEFILE|MINSERTFILE|\
 		MEXTCMD|MBROWSER|MWHEREISFILE|MGOTODIR|MSPELL|MLINTER)
 
 /* Control key sequences.  Changing these would be very, very bad. */
 #define NANO_CONTROL_SPACE 0
+#define NANO_CONTROL_C 3
 #define NANO_CONTROL_I 9
 #define NANO_CONTROL_3 27
 #define NANO_CONTROL_7 31
@@ -552,6 +798,15 @@ enum
 #define CONTROL_LEFT 0x401
 #define CONTROL_RIGHT 0x402
 
+#ifndef NANO_TINY
+/* Codes for the markers that a terminal sends around pasted text. */
+#define START_OF_PASTE 0x4FB
+#define END_OF_PASTE 0x4FC
+
+/* The length of such a marker, not counting its leading Escape. */
+#define PASTE_MARKER_LEN 5
+#endif
+
 #ifndef NANO_TINY
 /* An imaginary key for when we get a SIGWINCH (window resize). */
 #define KEY_WINCH -2
@@ -577,11 +832,65 @@ enum
 /* The default width of a tab in spaces. */
 #define WIDTH_OF_TAB 8
 
-/* The maximum number of search/replace history strings saved, not
- * counting the blank lines at their ends. */
+/* The default maximum number of search/replace history strings saved,
+ * not counting the blank lines at their ends. */
 #define MAX_SEARCH_HISTORY 100
 
+/* The maximum number of file extensions one syntax regex may expand to
+ * for choosing a syntax by table lookup. */
+#define MAX_EXPANDED_SUFFIXES 256
+
+/* The file in the home directory where parsed syntaxes are cached. */
+#define SYNTAX_CACHE_NAME ".nano/syntax_cache"
+
+/* The maximum number of pieces gathered into one writev() call when
+ * writing out a file; POSIX guarantees at least 16. */
+#if defined(IOV_MAX) && IOV_MAX < 1024
+#define MAX_WRITE_PIECES IOV_MAX
+#else
+#define MAX_WRITE_PIECES 1024
+#endif
+
+/* The most bytes of stdin that are read in between two checks for
+ * keystrokes, when stdin is read in while editing; also the number of
+ * bytes of command output in between two updates of the byte count. */
+#define STDIN_BATCH (1024 * 1024)
+
+/* The number of milliseconds in between two checks for the end of a
+ * background process that has closed its output but lingers. */
+#define REAP_INTERVAL 200
+
+/* The inotify events that matter for a followed file, and for the
+ * directory that it is in. */
+#define FOLLOW_FILE_EVENTS (IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+#define FOLLOW_DIR_EVENTS (IN_CREATE | IN_MOVED_TO)
+
+/* The events in a browsed directory that may change what is shown. */
+#define BROWSER_DIR_EVENTS (IN_ATTRIB | IN_MODIFY | IN_CLOSE_WRITE | \
+		IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+
+/* Lines at least this long get an index of their chunks, so that
+ * columns in them can be found without measuring the whole line. */
+#define CHUNKED_LENGTH 65536
+
+/* The approximate size of a chunk of such a line. */
+#define CHUNK_SIZE 4096
+
+/* Word counting uses a thread only for at least this many lines, and
+ * never more than this many threads. */
+#define TALLY_LINES 16384
+#define MAX_TALLY_THREADS 16
+
+/* The number of threads that look up the files shown in the browser,
+ * and how many milliseconds a new page waits for them before it gets
+ * drawn with placeholders. */
+#define PREFETCH_THREADS 4
+#define PREFETCH_PATIENCE 50
+
 /* The maximum number of bytes buffered at one time. */
 #define MAX_BUF_SIZE 128
 
+/* The initial capacity of the keystroke buffer; a power of two. */
+#define KEY_BUFFER_SIZE 1024
+
 #endif /* !NANO_H */
@@ -66,6 +66,32 @@ int do_statusbar_input(bool *ran_func, bool *finished,
 #ifndef NANO_TINY
     if (input == KEY_WINCH)
 	return KEY_WINCH;
+
+    /* Add a bracketed paste to the answer as plain text, so that any
+     * line breaks in it don't end the prompt. */
+    if (input == START_OF_PASTE) {
+	size_t paste_len, i;
+	char *paste = get_bracketed_paste(&paste_len);
+
+	if (!ISSET(RESTRICTED) || openfile->filename[0] == '\0' ||
+		currmenu != MWRITEFILE) {
+	    kbinput = (int *)nrealloc(kbinput, (kbinput_len + paste_len) *
+			sizeof(int));
+	    for (i = 0; i < paste_len; i++)
+		kbinput[kbinput_len++] = (unsigned char)paste[i];
+	}
+	free(paste);
+
+	if (kbinput != NULL) {
+	    do_statusbar_output(kbinput, kbinput_len, TRUE, NULL);
+	    kbinput_len = 0;
+	    free(kbinput);
+	    kbinput = NULL;
+	}
+
+	return ERR;
+    } else if (input == END_OF_PASTE)
+	return ERR;
 #endif
 
 #ifndef DISABLE_MOUSE
@@ -200,7 +226,7 @@ int do_statusbar_input(bool *ran_func, bool *finished,
 		f = sctofunc(s);
 		if (s->scfunc != NULL) {
 		    *ran_func = TRUE;
-		    if (f && (!ISSET(VIEW_MODE) || f->viewok) &&
+		    if (f && (!in_view_mode() || f->viewok) &&
 				f->scfunc != do_gotolinecolumn_void)
 			f->scfunc();
 		}
@@ -35,7 +35,26 @@ extern bool meta_key;
 extern bool func_key;
 extern bool focusing;
 
+#ifndef DISABLE_FOLLOW
+extern int follow_fd;
+#endif
+#ifndef NANO_TINY
+extern int command_fd;
+extern int command_input_fd;
+#endif
+#ifndef DISABLE_COLOR
+extern int lint_fd;
+#endif
+#ifdef USE_PREFETCH
+extern int prefetch_fd;
+#endif
+#ifdef USE_DIRWATCH
+extern int browser_watch_fd;
+#endif
+
 #ifndef NANO_TINY
+extern size_t edit_stamp;
+
 extern int controlleft;
 extern int controlright;
 #endif
@@ -128,6 +147,7 @@ extern filestruct *searchbot;
 extern filestruct *replace_history;
 extern filestruct *replaceage;
 extern filestruct *replacebot;
+extern ssize_t history_length;
 extern poshiststruct *position_history;
 #endif
 
@@ -150,8 +170,26 @@ typedef void (*functionptrtype)(void);
 #ifndef DISABLE_BROWSER
 char *do_browser(char *path, DIR *dir);
 char *do_browse_from(const char *inpath);
+void free_blurbs(void);
+int browser_sort(const void *va, const void *vb);
 void browser_init(const char *path, DIR *dir);
 functionptrtype parse_browser_input(int *kbinput);
+char *make_blurb(const char *path);
+const char *file_blurb(size_t index);
+#ifdef USE_PREFETCH
+size_t next_to_look_at(void);
+void *look_at_files(void *dummy);
+void start_helpers(void);
+void prefetch_blurbs(size_t from, size_t to);
+void handle_prefetch_results(void);
+#endif
+#ifdef USE_DIRWATCH
+void watch_directory(const char *path);
+void stop_watching_directory(void);
+size_t find_entry(const char *name);
+void invalidate_blurb(size_t index);
+bool handle_browser_events(void);
+#endif
 void browser_refresh(void);
 void browser_select_dirname(const char *needle);
 int filesearch_init(void);
@@ -168,6 +206,9 @@ char *striponedir(const char *path);
 #ifdef ENABLE_UTF8
 void utf8_init(void);
 bool using_utf8(void);
+#ifdef DEBUG
+void free_char_table(void);
+#endif
 #endif
 char *addstrings(char* str1, size_t len1, char* str2, size_t len2);
 #ifndef HAVE_ISBLANK
@@ -251,7 +292,18 @@ bool is_valid_mbstring(const char *s);
 #ifndef DISABLE_COLOR
 void set_colorpairs(void);
 void color_init(void);
+bool regex_matches(regexlisttype *e, const char *text);
+bool expand_sequence(const char **r, char ***set, size_t *count);
+bool expand_alternatives(const char **r, char ***set, size_t *count);
+bool is_word_byte(char c);
+char **regex_to_suffixes(const char *regex, size_t *count);
+size_t suffix_hash(const char *suffix);
+void build_syntax_index(void);
+void grow_suffix_table(void);
+syntaxtype *syntax_for_filename(const char *fullname);
 void color_update(void);
+regex_t *compile_color_regex(const char *regex, bool icase);
+void compile_syntax_colors(syntaxtype *sint);
 void reset_multis(filestruct *fileptr, bool force);
 void alloc_multidata_if_needed(filestruct *fileptr);
 void precalc_multicolorinfo(void);
@@ -296,6 +348,23 @@ bool close_buffer(bool quiet);
 #endif
 filestruct *read_line(char *buf, size_t buf_len, filestruct *prevnode);
 void read_file(FILE *f, int fd, const char *filename, bool undoable, bool checkwritable);
+void move_along(openfilestruct *buffer, filestruct *line, size_t x,
+	filestruct *to, size_t to_x);
+void feed_line(feedstruct *feed, char *line, size_t len);
+void feed_text(feedstruct *feed, const char *chunk, size_t count);
+bool finish_feed(feedstruct *feed);
+void report_feed(const feedstruct *feed);
+#ifndef NANO_TINY
+void set_feed_format(openfilestruct *buffer, int format);
+#endif
+#ifndef DISABLE_FOLLOW
+size_t read_followed(openfilestruct *buffer, int fd);
+void start_following(void);
+bool watch_in_use(int wd, const openfilestruct *buffer);
+void stop_following(openfilestruct *buffer);
+bool follow_file(openfilestruct *buffer);
+bool handle_follow_events(void);
+#endif
 int open_file(const char *filename, bool newfie, bool quiet, FILE **f);
 char *get_next_filename(const char *name, const char *suffix);
 void do_insertfile(
@@ -318,7 +387,16 @@ void init_backup_dir(void);
 int delete_lockfile(const char *lockfilename);
 int write_lockfile(const char *lockfilename, const char *origfilename, bool modified);
 #endif
+int copy_in_kernel(int in, int out);
 int copy_file(FILE *inn, FILE *out);
+bool write_pieces(int fd, struct iovec *pieces, int count);
+bool add_piece(int fd, struct iovec *pieces, int *count, const char
+	*data, size_t len);
+bool write_lines(int fd, size_t *lineswritten);
+#ifndef NANO_TINY
+int open_atomic_tempfile(const char *target, const struct stat *st,
+	char **name);
+#endif
 bool write_file(const char *name, FILE *f_open, bool tmp, append_type
 	append, bool nonamechange);
 #ifndef NANO_TINY
@@ -337,6 +415,15 @@ void free_chararray(char **array, size_t len);
 #endif
 #ifndef DISABLE_TABCOMP
 bool is_dir(const char *buf);
+int candidate_compare(const void *va, const void *vb);
+size_t first_candidate(const candidate *list, size_t len,
+	const char *prefix, size_t prefix_len);
+void free_candidates(candidate *list, size_t len);
+#ifdef DEBUG
+void free_completions(void);
+#endif
+bool read_candidates(const char *dirname);
+void fetch_users(void);
 char **username_tab_completion(const char *buf, size_t *num_matches,
 	size_t buf_len);
 char **cwd_tab_completion(const char *buf, bool allow_files, size_t
@@ -370,6 +457,12 @@ void shortcut_init(void);
 void set_lint_or_format_shortcuts(void);
 void set_spell_shortcuts(void);
 #endif
+int menu_index(int menu);
+size_t keytable_hash(int seq, bool meta);
+size_t functable_hash(void (*func)(void));
+void discard_shortcut_tables(void);
+void build_shortcut_tables(void);
+const sc *lookup_shortcut(int menu, int seq, bool meta);
 const subnfunc *sctofunc(const sc *s);
 const char *flagtostr(int flag);
 sc *strtosc(const char *input);
@@ -450,6 +543,7 @@ openfilestruct *make_new_opennode(void);
 void unlink_opennode(openfilestruct *fileptr);
 void delete_opennode(openfilestruct *fileptr);
 void print_view_warning(void);
+bool in_view_mode(void);
 void show_restricted_warning(void);
 #ifdef DISABLE_HELP
 void say_there_is_no_help(void);
@@ -479,6 +573,10 @@ int no_help(void);
 void no_current_file_name_warning(void);
 void do_exit(void);
 void close_and_go(void);
+void end_stdin_pager(bool done);
+void read_more_stdin(void);
+bool reading_stdin(void);
+bool wait_for_keystroke(void);
 void signal_init(void);
 RETSIGTYPE handle_hupterm(int signal);
 RETSIGTYPE do_suspend(int signal);
@@ -500,6 +598,10 @@ void enable_signals(void);
 void disable_flow_control(void);
 void enable_flow_control(void);
 void terminal_init(void);
+#ifndef NANO_TINY
+void set_bracketed_paste(bool on);
+void do_bracketed_paste(void);
+#endif
 int do_input(bool allow_funcs);
 #ifndef DISABLE_MOUSE
 int do_mouse(void);
@@ -561,8 +663,15 @@ void rcfile_error(const char *msg, ...);
 char *parse_argument(char *ptr);
 #ifndef DISABLE_COLOR
 char *parse_next_regex(char *ptr);
-bool nregcomp(const char *regex, int eflags);
+regex_t *nregcomp(const char *regex, int eflags);
+void new_syntax(const char *name);
 void parse_syntax(char *ptr);
+bool is_syntax_command(const char *keyword);
+char *syntax_cache_filename(void);
+void cache_syntax_file(const char *file, const struct stat *info);
+void load_syntax_cache(void);
+bool load_cached_syntaxes(const char *file, const struct stat *info);
+void save_syntax_cache(void);
 void parse_include(char *ptr);
 short color_to_short(const char *colorname, bool *bright);
 void parse_colors(char *ptr, bool icase);
@@ -603,6 +712,8 @@ void do_research(void);
 int replace_regexp(char *string, bool create);
 #endif
 char *replace_line(const char *needle);
+int replace_occurrence(const char *needle, size_t match_len,
+	bool *replaceall, bool first, size_t *length_change);
 ssize_t do_replace_loop(
 #ifndef DISABLE_SPELLER
 	bool whole_word_only,
@@ -625,9 +736,18 @@ char *get_history_completion(filestruct **h, char *s, size_t len);
 bool history_has_changed(void);
 void history_init(void);
 void history_reset(const filestruct *h);
-filestruct *find_history(const filestruct *h_start, const filestruct
-	*h_end, const char *s, size_t len);
+size_t history_hash(const historyindex *index, const char *s);
+filestruct **history_slot(const historyindex *index, const char *s);
+void grow_history_index(historyindex *index);
+void remember_history(historyindex *index, filestruct *node);
+void forget_history(historyindex *index, const filestruct *node);
+int history_compare(const void *va, const void *vb);
+void sort_history(historyindex *index, filestruct *hage);
+#ifdef DEBUG
+void free_history_indexes(void);
+#endif
 void update_history(filestruct **h, const char *s);
+void fill_history(filestruct **h, char **strings, size_t count);
 char *get_history_older(filestruct **h);
 char *get_history_newer(filestruct **h);
 void get_history_older_void(void);
@@ -654,8 +774,22 @@ void do_redo(void);
 #endif
 void do_enter(void);
 #ifndef NANO_TINY
-RETSIGTYPE cancel_command(int signal);
-bool execute_command(const char *command);
+void report_command_output(size_t total);
+filestruct *take_piped_text(bool cut);
+size_t gather_piped_text(const filestruct **line, size_t *x, char *buf,
+	size_t size);
+bool execute_command(const char *command, filestruct *input,
+	bool in_place);
+void end_command_input(void);
+void handle_command_input(void);
+void number_command_output(void);
+bool handle_command_output(void);
+void finish_command(void);
+void stop_command(void);
+void forget_command(const openfilestruct *buffer);
+bool command_lingers(void);
+void reap_command(void);
+bool running_command(void);
 #endif
 #ifndef DISABLE_WRAPPING
 void wrap_reset(void);
@@ -687,16 +821,46 @@ void do_justify_void(void);
 void do_full_justify(void);
 #endif
 #ifndef DISABLE_SPELLER
-bool do_int_spell_fix(const char *word);
+size_t word_run_length(const char *text);
+size_t spell_hash(const char *key, size_t len);
+spellword *find_spell_key(const char *key, size_t len);
+void add_spell_line(spellword *entry, filestruct *line);
+void index_spell_text(filestruct *line, const char *text, size_t first);
+void build_spell_index(char *list);
+void free_spell_index(void);
+bool do_int_spell_fix(spellword *entry);
 const char *do_int_speller(const char *tempfile_name);
 const char *do_alt_speller(char *tempfile_name);
 void do_spell(void);
 #endif
 #ifndef DISABLE_COLOR
+void free_lints(void);
+void cancel_linter(void);
+void forget_linter(const openfilestruct *buffer);
+bool start_linter(void);
+bool parse_lint_line(char *line);
+void handle_lint_output(void);
+bool linter_lingers(void);
+void reap_linter(void);
+void lint_after_save(void);
 void do_linter(void);
+#if !defined(DISABLE_SPELLER) && !defined(NANO_TINY)
+size_t hash_line(const char *text);
+bool lines_match(const linediff *diff, ssize_t x, ssize_t y);
+bool find_middle_snake(linediff *diff, ssize_t xoff, ssize_t xlim,
+	ssize_t yoff, ssize_t ylim, ssize_t *xmid, ssize_t *ymid);
+void compare_lines(linediff *diff, ssize_t xoff, ssize_t xlim,
+	ssize_t yoff, ssize_t ylim);
+char **split_lines(char *text, size_t size, size_t *count);
+void replace_lines(linediff *diff, size_t count, size_t s, size_t e,
+	size_t t, size_t u);
+bool apply_formatted_text(const char *filename);
+#endif
 void do_formatter(void);
 #endif
 #ifndef NANO_TINY
+void *tally_lines(void *data);
+void tally_buffer(size_t *words, size_t *chars);
 void do_wordlinechar_count(void);
 #endif
 void do_verbatim_input(void);
@@ -736,6 +900,17 @@ size_t xplustabs(void);
 size_t actual_x(const char *s, size_t column);
 size_t strnlenpt(const char *s, size_t maxlen);
 size_t strlenpt(const char *s);
+#ifndef NANO_TINY
+void free_chunks(linechunks *index);
+bool chunks_current(const filestruct *line);
+linechunks *line_chunks(filestruct *line);
+void update_chunks(filestruct *line, size_t stamp, size_t x,
+	size_t removed, size_t added);
+#endif
+size_t line_length(filestruct *line);
+size_t line_column(filestruct *line, size_t x);
+size_t line_actual_x(filestruct *line, size_t column);
+size_t line_width(filestruct *line);
 void new_magicline(void);
 #ifndef NANO_TINY
 void remove_magicline(void);
@@ -753,11 +928,16 @@ void dump_filestruct_reverse(void);
 #endif
 
 /* Most functions in winio.c. */
+void reserve_key_buffer(size_t needed);
+int peek_key_buffer(size_t index);
 void get_key_buffer(WINDOW *win);
 size_t get_key_buffer_len(void);
 void unget_input(int *input, size_t input_len);
 void unget_kbinput(int kbinput, bool metakey, bool funckey);
 int *get_input(WINDOW *win, size_t input_len);
+#ifndef NANO_TINY
+char *get_bracketed_paste(size_t *paste_len);
+#endif
 int get_kbinput(WINDOW *win);
 int parse_kbinput(WINDOW *win);
 int arrow_from_abcd(int kbinput);
@@ -784,6 +964,10 @@ void blank_bottombars(void);
 void check_statusblank(void);
 char *display_string(const char *buf, size_t start_col, size_t len, bool
 	dollars);
+char *display_line(filestruct *line, size_t start_col, size_t len, bool
+	dollars);
+char *expand_string(const char *buf, size_t start_index, size_t column,
+	size_t start_col, size_t len, bool dollars);
 void titlebar(const char *path);
 extern void set_modified(void);
 void statusbar(const char *msg, ...);
@@ -30,6 +30,13 @@
 #include <errno.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <fcntl.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#ifdef DEBUG
+#include <sys/time.h>
+#endif
 
 #ifndef DISABLE_NANORC
 
@@ -44,7 +51,11 @@ static const rcoption rcopts[] = {
     {"fill", 0},
 #endif
 #ifndef DISABLE_HISTORIES
+    {"historylength", 0},
     {"historylog", HISTORYLOG},
+#endif
+#ifndef DISABLE_COLOR
+    {"lintonsave", LINT_ON_SAVE},
 #endif
     {"morespace", MORE_SPACE},
 #ifndef DISABLE_MOUSE
@@ -82,8 +93,12 @@ static const rcoption rcopts[] = {
     {"tabsize", 0},
     {"tempfile", TEMP_FILE},
     {"view", VIEW_MODE},
+#ifndef DISABLE_FOLLOW
+    {"follow", FOLLOW_MODE},
+#endif
 #ifndef NANO_TINY
     {"allow_insecure_backup", INSECURE_BACKUP},
+    {"atomicsave", ATOMIC_SAVE},
     {"autoindent", AUTOINDENT},
     {"backup", BACKUP_FILE},
     {"backupdir", 0},
@@ -124,6 +139,51 @@ static syntaxtype *endsyntax = NULL;
 	/* The end of the list of syntaxes. */
 static colortype *endcolor = NULL;
 	/* The end of the color list for the current syntax. */
+static bool recording_syntaxes = FALSE;
+	/* Whether we're reading in a syntax file that may get cached. */
+static bool syntax_file_cacheable;
+	/* Whether the syntax file being read in can be cached, that is,
+	 * whether it only adds syntaxes, without any errors. */
+static syntaxtype **file_syntaxes = NULL;
+	/* The syntaxes that the syntax file being read in defines, with
+	 * NULL for those it redefined later on. */
+static size_t file_syntaxes_count = 0;
+	/* The number of entries in that array. */
+static char *cache_map = NULL;
+	/* The contents of the syntax cache as it was at startup. */
+static size_t cache_map_len = 0;
+	/* The length of those contents. */
+static cacheentry *cache_index = NULL;
+	/* The entries found in those contents. */
+static size_t cache_index_count = 0;
+	/* The number of those entries. */
+static char *new_cache = NULL;
+	/* The contents for the syntax cache as they are being built. */
+static size_t new_cache_len = 0, new_cache_size = 0;
+	/* The length of those contents, and their allocated size. */
+static bool cache_changed = FALSE;
+	/* Whether the new contents differ from those at startup. */
+static const char syntax_cache_header[] = {
+	'n', 'a', 'n', 'o', ' ', 's', 'y', 'n', 't', 'a', 'x', 'e', 's',
+	' ', '1', '\n', sizeof(size_t), sizeof(time_t), sizeof(off_t),
+	sizeof(short), sizeof(int), sizeof(bool),
+#ifdef HAVE_LIBMAGIC
+	'm',
+#endif
+#ifndef DISABLE_SPELLER
+	'f',
+#endif
+	'\0' };
+	/* The start of the syntax cache: a version tag, the sizes of the
+	 * native types it is made of, and the optional commands that this
+	 * nano understands, so that a cache from another build is not
+	 * mistaken for a valid one. */
+#ifdef DEBUG
+static long regex_compile_time = 0;
+	/* How many microseconds were spent compiling regexes. */
+static size_t regex_compile_count = 0;
+	/* And how many of them were compiled. */
+#endif
 #endif
 
 /* We have an error in some part of the rcfile.  Print the error message
@@ -238,63 +298,55 @@ char *parse_next_regex(char *ptr)
     return ptr;
 }
 
-/* Compile the regular expression regex to see if it's valid.  Return
- * TRUE if it is, or FALSE otherwise. */
-bool nregcomp(const char *regex, int eflags)
+/* Compile the regular expression regex, and return it if it's valid.
+ * Otherwise, complain and return NULL. */
+regex_t *nregcomp(const char *regex, int eflags)
 {
-    regex_t preg;
+    regex_t *preg = (regex_t *)nmalloc(sizeof(regex_t));
     const char *r = fixbounds(regex);
-    int rc = regcomp(&preg, r, REG_EXTENDED | eflags);
+    int rc;
+#ifdef DEBUG
+    struct timeval before, after;
+
+    gettimeofday(&before, NULL);
+#endif
+
+    rc = regcomp(preg, r, REG_EXTENDED | eflags);
+
+#ifdef DEBUG
+    gettimeofday(&after, NULL);
+    regex_compile_time += (after.tv_sec - before.tv_sec) * 1000000 +
+		after.tv_usec - before.tv_usec;
+    regex_compile_count++;
+#endif
 
     if (rc != 0) {
-	size_t len = regerror(rc, &preg, NULL, 0);
+	size_t len = regerror(rc, preg, NULL, 0);
 	char *str = charalloc(len);
 
-	regerror(rc, &preg, str, len);
+	regerror(rc, preg, str, len);
 	rcfile_error(N_("Bad regex \"%s\": %s"), r, str);
 	free(str);
+	free(preg);
+	return NULL;
     }
 
-    regfree(&preg);
-    return (rc == 0);
+    return preg;
 }
 
-/* Parse the next syntax string from the line at ptr, and add it to the
- * global list of color syntaxes. */
-void parse_syntax(char *ptr)
+/* Add a new, empty syntax with the given name to the end of the global
+ * list of color syntaxes, and make it the current one. */
+void new_syntax(const char *name)
 {
-    const char *fileregptr = NULL, *nameptr = NULL;
     syntaxtype *tmpsyntax, *prev_syntax;
-    regexlisttype *endext = NULL;
-	/* The end of the extensions list for this syntax. */
-
-    assert(ptr != NULL);
-
-    if (*ptr == '\0') {
-	rcfile_error(N_("Missing syntax name"));
-	return;
-    }
-
-    if (*ptr != '"') {
-	rcfile_error(
-		N_("Regex strings must begin and end with a \" character"));
-	return;
-    }
-
-    ptr++;
-
-    nameptr = ptr;
-    ptr = parse_next_regex(ptr);
-
-    if (ptr == NULL)
-	return;
+    size_t i;
 
     /* Search for a duplicate syntax name.  If we find one, free it, so
      * that we always use the last syntax with a given name. */
     prev_syntax = NULL;
     for (tmpsyntax = syntaxes; tmpsyntax != NULL;
 	tmpsyntax = tmpsyntax->next) {
-	if (strcmp(nameptr, tmpsyntax->desc) == 0) {
+	if (strcmp(name, tmpsyntax->desc) == 0) {
 	    syntaxtype *old_syntax = tmpsyntax;
 
 	    if (endsyntax == tmpsyntax)
@@ -306,6 +358,12 @@ void parse_syntax(char *ptr)
 	    else
 		syntaxes = tmpsyntax;
 
+	    /* If the syntax file that is being read in defined it, it is
+	     * no longer part of what that file defines. */
+	    for (i = 0; i < file_syntaxes_count; i++)
+		if (file_syntaxes[i] == old_syntax)
+		    file_syntaxes[i] = NULL;
+
 	    free(old_syntax->desc);
 	    free(old_syntax);
 	    break;
@@ -324,7 +382,7 @@ void parse_syntax(char *ptr)
 #endif
     }
 
-    endsyntax->desc = mallocstrcpy(NULL, nameptr);
+    endsyntax->desc = mallocstrcpy(NULL, name);
     endsyntax->color = NULL;
     endcolor = NULL;
     endsyntax->extensions = NULL;
@@ -335,6 +393,45 @@ void parse_syntax(char *ptr)
     endsyntax->linter = NULL;
     endsyntax->formatter = NULL;
 
+    /* Remember which syntaxes the syntax file being read in defines. */
+    if (recording_syntaxes) {
+	file_syntaxes = (syntaxtype **)nrealloc(file_syntaxes,
+		(file_syntaxes_count + 1) * sizeof(syntaxtype *));
+	file_syntaxes[file_syntaxes_count++] = endsyntax;
+    }
+}
+
+/* Parse the next syntax string from the line at ptr, and add it to the
+ * global list of color syntaxes. */
+void parse_syntax(char *ptr)
+{
+    const char *fileregptr = NULL, *nameptr = NULL;
+    regexlisttype *endext = NULL;
+	/* The end of the extensions list for this syntax. */
+
+    assert(ptr != NULL);
+
+    if (*ptr == '\0') {
+	rcfile_error(N_("Missing syntax name"));
+	return;
+    }
+
+    if (*ptr != '"') {
+	rcfile_error(
+		N_("Regex strings must begin and end with a \" character"));
+	return;
+    }
+
+    ptr++;
+
+    nameptr = ptr;
+    ptr = parse_next_regex(ptr);
+
+    if (ptr == NULL)
+	return;
+
+    new_syntax(nameptr);
+
 #ifdef DEBUG
     fprintf(stderr, "Starting a new syntax type: \"%s\"\n", nameptr);
 #endif
@@ -372,10 +469,11 @@ void parse_syntax(char *ptr)
 
 	newext = (regexlisttype *)nmalloc(sizeof(regexlisttype));
 
-	/* Save the extension regex if it's valid. */
-	if (nregcomp(fileregptr, REG_NOSUB)) {
+	/* Save the extension regex if it's valid, in compiled form too,
+	 * since it will be tried on every file that gets opened. */
+	newext->ext = nregcomp(fileregptr, REG_NOSUB);
+	if (newext->ext != NULL) {
 	    newext->ext_regex = mallocstrcpy(NULL, fileregptr);
-	    newext->ext = NULL;
 
 	    if (endext == NULL)
 		endsyntax->extensions = newext;
@@ -541,6 +639,9 @@ void parse_binding(char *ptr, bool dobind)
 #endif
     }
 
+    /* The shortcut list is about to change, so stop using its index. */
+    discard_shortcut_tables();
+
     /* Now find and delete any existing same shortcut in the menu(s). */
     for (s = sclist; s != NULL; s = s->next) {
 	if ((s->menus & menu) && !strcmp(s->keystr, keycopy)) {
@@ -571,11 +672,433 @@ void parse_binding(char *ptr, bool dobind)
 
 
 #ifndef DISABLE_COLOR
+/* Return whether the given keyword is one of the commands that make up
+ * a syntax definition, after its "syntax" command. */
+bool is_syntax_command(const char *keyword)
+{
+    return (strcasecmp(keyword, "magic") == 0 ||
+	strcasecmp(keyword, "header") == 0 ||
+	strcasecmp(keyword, "color") == 0 ||
+	strcasecmp(keyword, "icolor") == 0 ||
+	strcasecmp(keyword, "linter") == 0 ||
+	strcasecmp(keyword, "formatter") == 0);
+}
+
+/* Return the path of the syntax cache, or NULL if there is no home
+ * directory.  The cache is kept only when ~/.nano exists. */
+char *syntax_cache_filename(void)
+{
+    char *cachename;
+
+    get_homedir();
+
+    if (homedir == NULL)
+	return NULL;
+
+    cachename = charalloc(strlen(homedir) + strlen(SYNTAX_CACHE_NAME) + 2);
+    sprintf(cachename, "%s/%s", homedir, SYNTAX_CACHE_NAME);
+
+    return cachename;
+}
+
+/* Append len bytes from data to the new contents of the syntax cache. */
+static void cache_put(const void *data, size_t len)
+{
+    if (new_cache_len + len > new_cache_size) {
+	if (new_cache_size == 0)
+	    new_cache_size = MAX_BUF_SIZE;
+	while (new_cache_len + len > new_cache_size)
+	    new_cache_size *= 2;
+	new_cache = charealloc(new_cache, new_cache_size);
+    }
+
+    memcpy(new_cache + new_cache_len, data, len);
+    new_cache_len += len;
+}
+
+/* Append the given string, which may be NULL, to the new contents of
+ * the syntax cache: its length including the terminating null byte
+ * (zero for NULL), followed by its bytes. */
+static void cache_put_string(const char *str)
+{
+    size_t len = (str == NULL) ? 0 : strlen(str) + 1;
+
+    cache_put(&len, sizeof(len));
+    if (len > 0)
+	cache_put(str, len);
+}
+
+/* Append the regex strings in the given list to the new contents of
+ * the syntax cache, preceded by their number. */
+static void cache_put_regexes(const regexlisttype *list)
+{
+    const regexlisttype *e;
+    size_t count = 0;
+
+    for (e = list; e != NULL; e = e->next)
+	count++;
+
+    cache_put(&count, sizeof(count));
+    for (e = list; e != NULL; e = e->next)
+	cache_put_string(e->ext_regex);
+}
+
+/* Append an entry to the new contents of the syntax cache with the
+ * syntaxes that were just read in from the given file. */
+void cache_syntax_file(const char *file, const struct stat *info)
+{
+    size_t start, len, count = 0, i;
+
+    for (i = 0; i < file_syntaxes_count; i++)
+	if (file_syntaxes[i] != NULL)
+	    count++;
+
+    /* Leave room for the length of the entry, and fill it in later. */
+    start = new_cache_len;
+    cache_put(&start, sizeof(start));
+
+    cache_put_string(file);
+    cache_put(&info->st_mtime, sizeof(info->st_mtime));
+    cache_put(&info->st_size, sizeof(info->st_size));
+    cache_put(&count, sizeof(count));
+
+    for (i = 0; i < file_syntaxes_count; i++) {
+	const syntaxtype *sint = file_syntaxes[i];
+	const colortype *c;
+
+	if (sint == NULL)
+	    continue;
+
+	cache_put_string(sint->desc);
+	cache_put_string(sint->linter);
+	cache_put_string(sint->formatter);
+	cache_put(&sint->nmultis, sizeof(sint->nmultis));
+	cache_put_regexes(sint->extensions);
+	cache_put_regexes(sint->headers);
+	cache_put_regexes(sint->magics);
+
+	count = 0;
+	for (c = sint->color; c != NULL; c = c->next)
+	    count++;
+	cache_put(&count, sizeof(count));
+
+	for (c = sint->color; c != NULL; c = c->next) {
+	    cache_put(&c->fg, sizeof(c->fg));
+	    cache_put(&c->bg, sizeof(c->bg));
+	    cache_put(&c->bright, sizeof(c->bright));
+	    cache_put(&c->icase, sizeof(c->icase));
+	    cache_put(&c->id, sizeof(c->id));
+	    cache_put_string(c->start_regex);
+	    cache_put_string(c->end_regex);
+	}
+    }
+
+    len = new_cache_len - start - sizeof(len);
+    memcpy(new_cache + start, &len, sizeof(len));
+
+    cache_changed = TRUE;
+}
+
+/* Copy len bytes from the cache contents at *ptr into dest, and step
+ * past them.  Return FALSE if they run beyond end. */
+static bool cache_get(const char **ptr, const char *end, void *dest,
+	size_t len)
+{
+    if ((size_t)(end - *ptr) < len)
+	return FALSE;
+
+    memcpy(dest, *ptr, len);
+    *ptr += len;
+
+    return TRUE;
+}
+
+/* Point *str at the string stored at *ptr in the cache contents (or at
+ * NULL), and step past it.  Return FALSE if the data is malformed. */
+static bool cache_get_string(const char **ptr, const char *end,
+	const char **str)
+{
+    size_t len;
+
+    if (!cache_get(ptr, end, &len, sizeof(len)))
+	return FALSE;
+
+    if (len == 0) {
+	*str = NULL;
+	return TRUE;
+    }
+
+    if ((size_t)(end - *ptr) < len || (*ptr)[len - 1] != '\0')
+	return FALSE;
+
+    *str = *ptr;
+    *ptr += len;
+
+    return TRUE;
+}
+
+/* Read a list of regex strings from the cache contents at *ptr, and
+ * add them uncompiled to the list at *list.  Return FALSE if the data
+ * is malformed. */
+static bool cache_get_regexes(const char **ptr, const char *end,
+	regexlisttype **list)
+{
+    size_t count;
+
+    if (!cache_get(ptr, end, &count, sizeof(count)))
+	return FALSE;
+
+    while (count-- > 0) {
+	const char *regex;
+
+	if (!cache_get_string(ptr, end, &regex) || regex == NULL)
+	    return FALSE;
+
+	*list = (regexlisttype *)nmalloc(sizeof(regexlisttype));
+	(*list)->ext_regex = mallocstrcpy(NULL, regex);
+	(*list)->ext = NULL;
+	(*list)->next = NULL;
+	list = &(*list)->next;
+    }
+
+    return TRUE;
+}
+
+/* Map the syntax cache into memory, if it exists and was written by a
+ * nano of the same kind, and index its entries. */
+void load_syntax_cache(void)
+{
+    char *cachename = syntax_cache_filename();
+    const char *ptr, *end;
+    struct stat fileinfo;
+    int fd;
+
+    if (cachename == NULL)
+	return;
+
+    fd = open(cachename, O_RDONLY);
+    free(cachename);
+
+    if (fd == -1)
+	return;
+
+    if (fstat(fd, &fileinfo) == -1 || !S_ISREG(fileinfo.st_mode) ||
+		fileinfo.st_size < sizeof(syntax_cache_header)) {
+	close(fd);
+	return;
+    }
+
+    cache_map_len = fileinfo.st_size;
+#ifdef HAVE_MMAP
+    cache_map = mmap(NULL, cache_map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (cache_map == MAP_FAILED)
+	cache_map = NULL;
+#else
+    cache_map = charalloc(cache_map_len);
+    if (read(fd, cache_map, cache_map_len) != cache_map_len) {
+	free(cache_map);
+	cache_map = NULL;
+    }
+#endif
+    close(fd);
+
+    if (cache_map == NULL)
+	return;
+
+    ptr = cache_map;
+    end = cache_map + cache_map_len;
+
+    /* A cache of another version or from another kind of build is
+     * simply ignored, and will get overwritten. */
+    if (memcmp(ptr, syntax_cache_header, sizeof(syntax_cache_header)) != 0) {
+	cache_index_count = 0;
+	return;
+    }
+    ptr += sizeof(syntax_cache_header);
+
+    while (ptr < end) {
+	cacheentry *entry;
+	const char *entry_end;
+	size_t len;
+
+	if (!cache_get(&ptr, end, &len, sizeof(len)) ||
+		(size_t)(end - ptr) < len)
+	    break;
+	entry_end = ptr + len;
+
+	cache_index = (cacheentry *)nrealloc(cache_index,
+		(cache_index_count + 1) * sizeof(cacheentry));
+	entry = &cache_index[cache_index_count];
+
+	if (!cache_get_string(&ptr, entry_end, &entry->filename) ||
+		entry->filename == NULL ||
+		!cache_get(&ptr, entry_end, &entry->mtime,
+		sizeof(entry->mtime)) ||
+		!cache_get(&ptr, entry_end, &entry->size,
+		sizeof(entry->size)))
+	    break;
+
+	entry->start = entry_end - len - sizeof(len);
+	entry->data = ptr;
+	entry->end = entry_end;
+	entry->used = FALSE;
+	cache_index_count++;
+
+	ptr = entry_end;
+    }
+}
+
+/* If the syntax cache has an up-to-date entry for the given file, add
+ * the syntaxes in it to the global list, without compiling any of their
+ * regexes yet, and return TRUE.  Otherwise, return FALSE. */
+bool load_cached_syntaxes(const char *file, const struct stat *info)
+{
+    cacheentry *entry = NULL;
+    const char *ptr, *end;
+    size_t count, i;
+
+    for (i = 0; i < cache_index_count; i++) {
+	if (strcmp(cache_index[i].filename, file) == 0) {
+	    entry = &cache_index[i];
+	    break;
+	}
+    }
+
+    if (entry == NULL || entry->used || entry->mtime != info->st_mtime ||
+		entry->size != info->st_size)
+	return FALSE;
+
+    ptr = entry->data;
+    end = entry->end;
+
+    if (!cache_get(&ptr, end, &count, sizeof(count)))
+	return FALSE;
+
+    while (count-- > 0) {
+	const char *desc, *linter, *formatter;
+	size_t ncolors;
+
+	if (!cache_get_string(&ptr, end, &desc) || desc == NULL)
+	    return FALSE;
+
+	new_syntax(desc);
+
+	if (!cache_get_string(&ptr, end, &linter) ||
+		!cache_get_string(&ptr, end, &formatter) ||
+		!cache_get(&ptr, end, &endsyntax->nmultis,
+		sizeof(endsyntax->nmultis)) ||
+		!cache_get_regexes(&ptr, end, &endsyntax->extensions) ||
+		!cache_get_regexes(&ptr, end, &endsyntax->headers) ||
+		!cache_get_regexes(&ptr, end, &endsyntax->magics) ||
+		!cache_get(&ptr, end, &ncolors, sizeof(ncolors)))
+	    return FALSE;
+
+	endsyntax->linter = (linter == NULL) ? NULL :
+		mallocstrcpy(NULL, linter);
+	endsyntax->formatter = (formatter == NULL) ? NULL :
+		mallocstrcpy(NULL, formatter);
+
+	while (ncolors-- > 0) {
+	    colortype *newcolor = (colortype *)nmalloc(sizeof(colortype));
+	    const char *start_regex, *end_regex;
+
+	    if (!cache_get(&ptr, end, &newcolor->fg, sizeof(newcolor->fg)) ||
+		!cache_get(&ptr, end, &newcolor->bg, sizeof(newcolor->bg)) ||
+		!cache_get(&ptr, end, &newcolor->bright,
+			sizeof(newcolor->bright)) ||
+		!cache_get(&ptr, end, &newcolor->icase,
+			sizeof(newcolor->icase)) ||
+		!cache_get(&ptr, end, &newcolor->id, sizeof(newcolor->id)) ||
+		!cache_get_string(&ptr, end, &start_regex) ||
+		start_regex == NULL ||
+		!cache_get_string(&ptr, end, &end_regex)) {
+		free(newcolor);
+		return FALSE;
+	    }
+
+	    newcolor->start_regex = mallocstrcpy(NULL, start_regex);
+	    newcolor->start = NULL;
+	    newcolor->end_regex = (end_regex == NULL) ? NULL :
+		mallocstrcpy(NULL, end_regex);
+	    newcolor->end = NULL;
+	    newcolor->next = NULL;
+
+	    if (endcolor == NULL)
+		endsyntax->color = newcolor;
+	    else
+		endcolor->next = newcolor;
+	    endcolor = newcolor;
+	}
+    }
+
+    /* Carry the entry over into the new contents of the cache. */
+    entry->used = TRUE;
+    cache_put(entry->start, entry->end - entry->start);
+
+    return TRUE;
+}
+
+/* Write out the new contents of the syntax cache when they differ from
+ * the old ones, and let go of both. */
+void save_syntax_cache(void)
+{
+    char *cachename = syntax_cache_filename();
+    size_t i;
+
+    for (i = 0; i < cache_index_count; i++)
+	if (!cache_index[i].used)
+	    cache_changed = TRUE;
+
+    if (cachename != NULL && cache_changed) {
+	char *tempname = charalloc(strlen(cachename) + 24);
+	int fd;
+
+	/* Write to a temporary file first, so that another nano never
+	 * sees a half-written cache.  When ~/.nano doesn't exist, this
+	 * fails, and there simply is no cache. */
+	sprintf(tempname, "%s.%ld", cachename, (long)getpid());
+	fd = open(tempname, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+
+	if (fd != -1) {
+	    bool written = (write(fd, syntax_cache_header,
+		sizeof(syntax_cache_header)) == sizeof(syntax_cache_header) &&
+		write(fd, new_cache, new_cache_len) == new_cache_len);
+
+	    if (close(fd) == 0 && written)
+		rename(tempname, cachename);
+	    else
+		unlink(tempname);
+	}
+
+	free(tempname);
+    }
+
+    free(cachename);
+    free(new_cache);
+    new_cache = NULL;
+    new_cache_len = new_cache_size = 0;
+    free(cache_index);
+    cache_index = NULL;
+    cache_index_count = 0;
+
+    if (cache_map != NULL) {
+#ifdef HAVE_MMAP
+	munmap(cache_map, cache_map_len);
+#else
+	free(cache_map);
+#endif
+	cache_map = NULL;
+    }
+}
+
 /* Read and parse additional syntax files. */
 static void _parse_include(char *file)
 {
     struct stat rcinfo;
     FILE *rcstream;
+    bool errors_save = errors;
+    time_t read_time = time(NULL);
+	/* When the file was about to be looked at. */
 
     /* Can't get the specified file's full path because it may screw up
      * our cwd depending on the parent directories' permissions (see
@@ -588,8 +1111,15 @@ static void _parse_include(char *file)
 	    rcfile_error(S_ISDIR(rcinfo.st_mode) ?
 		_("\"%s\" is a directory") :
 		_("\"%s\" is a device file"), file);
+	} else if (S_ISREG(rcinfo.st_mode) &&
+		load_cached_syntaxes(file, &rcinfo)) {
+#ifdef DEBUG
+	    fprintf(stderr, "Took the syntaxes of \"%s\" from the cache\n", file);
+#endif
+	    return;
 	}
-    }
+    } else
+	rcinfo.st_mode = 0;
 
     /* Open the new syntax file. */
     if ((rcstream = fopen(file, "rb")) == NULL) {
@@ -607,7 +1137,25 @@ static void _parse_include(char *file)
     fprintf(stderr, "Parsing file \"%s\"\n", file);
 #endif
 
+    /* Keep track of what the file defines, so it can be cached.  As
+     * modification times count in whole seconds, a file that was
+     * modified in the second that it is read isn't cached, because a
+     * later change in that same second wouldn't show. */
+    recording_syntaxes = TRUE;
+    syntax_file_cacheable = S_ISREG(rcinfo.st_mode) &&
+	rcinfo.st_mtime < read_time;
+    errors = FALSE;
+
     parse_rcfile(rcstream, TRUE);
+
+    if (syntax_file_cacheable && !errors)
+	cache_syntax_file(file, &rcinfo);
+
+    recording_syntaxes = FALSE;
+    free(file_syntaxes);
+    file_syntaxes = NULL;
+    file_syntaxes_count = 0;
+    errors = errors || errors_save;
 }
 
 void parse_include(char *ptr)
@@ -717,8 +1265,6 @@ void parse_colors(char *ptr, bool icase)
     while (ptr != NULL && *ptr != '\0') {
 	colortype *newcolor;
 	    /* The container for a color plus its regexes. */
-	bool cancelled = FALSE;
-	    /* The start expression was bad. */
 	bool expectend = FALSE;
 	    /* Do we expect an end= line? */
 
@@ -743,44 +1289,40 @@ void parse_colors(char *ptr, bool icase)
 
 	newcolor = (colortype *)nmalloc(sizeof(colortype));
 
-	/* Save the starting regex string if it's valid, and set up the
-	 * color information. */
-	if (nregcomp(fgstr, icase ? REG_ICASE : 0)) {
-	    newcolor->fg = fg;
-	    newcolor->bg = bg;
-	    newcolor->bright = bright;
-	    newcolor->icase = icase;
+	/* Save the starting regex string, and set up the color
+	 * information.  The regex gets compiled, and thus checked, only
+	 * when a file first needs this syntax; see color_update(). */
+	newcolor->fg = fg;
+	newcolor->bg = bg;
+	newcolor->bright = bright;
+	newcolor->icase = icase;
 
-	    newcolor->start_regex = mallocstrcpy(NULL, fgstr);
-	    newcolor->start = NULL;
+	newcolor->start_regex = mallocstrcpy(NULL, fgstr);
+	newcolor->start = NULL;
 
-	    newcolor->end_regex = NULL;
-	    newcolor->end = NULL;
+	newcolor->end_regex = NULL;
+	newcolor->end = NULL;
 
-	    newcolor->next = NULL;
+	newcolor->next = NULL;
 
-	    if (endcolor == NULL) {
-		endsyntax->color = newcolor;
+	if (endcolor == NULL) {
+	    endsyntax->color = newcolor;
 #ifdef DEBUG
-		fprintf(stderr, "Starting a new colorstring for fg %hd, bg %hd\n", fg, bg);
+	    fprintf(stderr, "Starting a new colorstring for fg %hd, bg %hd\n", fg, bg);
 #endif
-	    } else {
+	} else {
 #ifdef DEBUG
-		fprintf(stderr, "Adding new entry for fg %hd, bg %hd\n", fg, bg);
+	    fprintf(stderr, "Adding new entry for fg %hd, bg %hd\n", fg, bg);
 #endif
-		/* Need to recompute endcolor now so we can extend
-		 * colors to syntaxes. */
-		for (endcolor = endsyntax->color; endcolor->next != NULL; endcolor = endcolor->next)
-		    ;
-		endcolor->next = newcolor;
-	    }
-
-	    endcolor = newcolor;
-	} else {
-	    free(newcolor);
-	    cancelled = TRUE;
+	    /* Need to recompute endcolor now so we can extend
+	     * colors to syntaxes. */
+	    for (endcolor = endsyntax->color; endcolor->next != NULL; endcolor = endcolor->next)
+		;
+	    endcolor->next = newcolor;
 	}
 
+	endcolor = newcolor;
+
 	if (expectend) {
 	    if (ptr == NULL || strncasecmp(ptr, "end=", 4) != 0) {
 		rcfile_error(
@@ -801,14 +1343,8 @@ void parse_colors(char *ptr, bool icase)
 	    if (ptr == NULL)
 		break;
 
-	    /* If the start regex was invalid, skip past the end regex
-	     * to stay in sync. */
-	    if (cancelled)
-		continue;
-
-	    /* Save the ending regex string if it's valid. */
-	    newcolor->end_regex = (nregcomp(fgstr, icase ? REG_ICASE :
-		0)) ? mallocstrcpy(NULL, fgstr) : NULL;
+	    /* Save the ending regex string. */
+	    newcolor->end_regex = mallocstrcpy(NULL, fgstr);
 
 	    /* Lame way to skip another static counter. */
 	    newcolor->id = endsyntax->nmultis;
@@ -893,10 +1429,10 @@ void parse_header_exp(char *ptr)
 
 	newheader = (regexlisttype *)nmalloc(sizeof(regexlisttype));
 
-	/* Save the regex string if it's valid. */
-	if (nregcomp(regexstring, 0)) {
+	/* Save the regex string if it's valid, in compiled form too. */
+	newheader->ext = nregcomp(regexstring, 0);
+	if (newheader->ext != NULL) {
 	    newheader->ext_regex = mallocstrcpy(NULL, regexstring);
-	    newheader->ext = NULL;
 
 	    if (endheader == NULL)
 		endsyntax->headers = newheader;
@@ -958,10 +1494,10 @@ void parse_magic_exp(char *ptr)
 
 	newmagic = (regexlisttype *)nmalloc(sizeof(regexlisttype));
 
-	/* Save the regex string if it's valid. */
-	if (nregcomp(regexstring, REG_NOSUB)) {
+	/* Save the regex string if it's valid, in compiled form too. */
+	newmagic->ext = nregcomp(regexstring, REG_NOSUB);
+	if (newmagic->ext != NULL) {
 	    newmagic->ext_regex = mallocstrcpy(NULL, regexstring);
-	    newmagic->ext = NULL;
 
 	    if (endmagic == NULL)
 		endsyntax->magics = newmagic;
@@ -1105,6 +1641,9 @@ void parse_rcfile(FILE *rcstream
 		if (!strcmp(ts->desc, syntaxname))
 		    break;
 
+	    /* Extending a syntax from elsewhere can't be cached. */
+	    syntax_file_cacheable = FALSE;
+
 	    if (ts == NULL) {
 		rcfile_error(N_("Could not find syntax \"%s\" to extend"), syntaxname);
 		continue;
@@ -1115,6 +1654,12 @@ void parse_rcfile(FILE *rcstream
 		ptr = parse_next_word(ptr);
 	    }
 	}
+
+	/* A syntax file can be cached only when it consists of nothing
+	 * but complete syntax definitions. */
+	if (syntax_only && strcasecmp(keyword, "syntax") != 0 &&
+		(file_syntaxes_count == 0 || !is_syntax_command(keyword)))
+	    syntax_file_cacheable = FALSE;
 #endif
 
 	/* Try to parse the keyword. */
@@ -1315,6 +1860,19 @@ void parse_rcfile(FILE *rcstream
 			    quotestr = option;
 			else
 #endif
+#ifndef DISABLE_HISTORIES
+			if (strcasecmp(rcopts[i].name,
+				"historylength") == 0) {
+			    if (!parse_num(option, &history_length) ||
+				history_length <= 0) {
+				rcfile_error(
+					N_("Requested history length \"%s\" is invalid"),
+					option);
+				history_length = MAX_SEARCH_HISTORY;
+			    } else
+				free(option);
+			} else
+#endif
 #ifndef NANO_TINY
 			if (strcasecmp(rcopts[i].name,
 				"backupdir") == 0)
@@ -1375,6 +1933,11 @@ void do_rcfile(void)
     struct stat rcinfo;
     FILE *rcstream;
 
+#ifndef DISABLE_COLOR
+    /* Syntax files that haven't changed can be taken from the cache. */
+    load_syntax_cache();
+#endif
+
     nanorc = mallocstrcpy(nanorc, SYSCONFDIR "/nanorc");
 
     /* Don't open directories, character files, or block files. */
@@ -1445,6 +2008,18 @@ void do_rcfile(void)
     free(nanorc);
     nanorc = NULL;
 
+#ifndef DISABLE_COLOR
+    save_syntax_cache();
+#endif
+
+    /* The bindings are final now, so index them for fast lookups. */
+    build_shortcut_tables();
+
+#if defined(DEBUG) && !defined(DISABLE_COLOR)
+    fprintf(stderr, "Compiled %lu syntax-selecting regexes in %ld microseconds\n",
+	(unsigned long)regex_compile_count, regex_compile_time);
+#endif
+
     //if (errors && !ISSET(QUIET)) {
 	errors = FALSE;
 	fprintf(stderr,
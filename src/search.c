@@ -35,6 +35,9 @@ static bool search_last_line = FALSE;
 #ifndef DISABLE_HISTORIES
 static bool history_changed = FALSE;
 	/* Have any of the history lists changed? */
+static historyindex search_index, replace_index;
+	/* The indexes of the strings in the search and replace history
+	 * lists. */
 #endif
 #ifdef HAVE_REGEX_H
 static bool regexp_compiled = FALSE;
@@ -630,6 +633,86 @@ char *replace_line(const char *needle)
     return copy;
 }
 
+/* Unless all occurrences are being replaced already, highlight the one
+ * of match_len bytes at the cursor and ask whether to replace it, and if
+ * so, replace needle there with answer.  first is TRUE when nothing has
+ * been replaced yet, and length_change gets the change in the length of
+ * the line.  Return -1 if we canceled, 0 if the occurrence was skipped,
+ * and 1 if it was replaced, after setting replaceall when the user chose
+ * to replace all of them. */
+int replace_occurrence(const char *needle, size_t match_len,
+	bool *replaceall, bool first, size_t *length_change)
+{
+    filestruct *line = openfile->current;
+    char *copy;
+    int choice = 0;
+
+    if (!*replaceall) {
+	size_t xpt = xplustabs();
+	char *exp_word = display_line(line, xpt, line_column(line,
+		openfile->current_x + match_len) - xpt, FALSE);
+
+	openfile->placewewant = xpt;
+
+	/* Refresh the edit window, scrolling it if necessary. */
+	edit_refresh();
+
+	/* Don't show cursor, to not distract from highlighted match. */
+	curs_set(0);
+
+	do_replace_highlight(TRUE, exp_word);
+
+	/* TRANSLATORS: This is a prompt. */
+	choice = do_yesno_prompt(TRUE, _("Replace this instance?"));
+
+	do_replace_highlight(FALSE, exp_word);
+
+	free(exp_word);
+
+	if (choice == -1)
+	    return -1;
+	else if (choice == 0)
+	    return 0;
+	else if (choice == 2)
+	    *replaceall = TRUE;
+    }
+
+#ifndef NANO_TINY
+    add_undo(REPLACE);
+#endif
+
+    copy = replace_line(needle);
+
+    *length_change = strlen(copy) - strlen(line->data);
+
+    /* Update the file size, and put the changed line into place. */
+    openfile->totsize += mbstrlen(copy) - mbstrlen(line->data);
+    free(line->data);
+    line->data = copy;
+
+#ifndef DISABLE_COLOR
+    /* Reset the precalculated multiline-regex hints only when
+     * the first replacement has been made. */
+    if (first)
+	reset_multis(line, TRUE);
+#endif
+
+    if (!*replaceall) {
+#ifndef DISABLE_COLOR
+	/* If color syntaxes are available and turned on, we
+	 * need to call edit_refresh(). */
+	if (openfile->colorstrings != NULL && !ISSET(NO_COLOR_SYNTAX))
+	    edit_refresh();
+	else
+#endif
+	    update_line(line, openfile->current_x);
+    }
+
+    set_modified();
+
+    return 1;
+}
+
 /* Step through each replace word and prompt user before replacing.
  * Parameters real_current and real_current_x are needed in order to
  * allow the cursor position to be updated when a word before the cursor
@@ -646,7 +729,7 @@ ssize_t do_replace_loop(
 	*real_current_x, const char *needle)
 {
     ssize_t numreplaced = -1;
-    size_t match_len;
+    size_t match_len, length_change;
     bool replaceall = FALSE;
 #ifndef NANO_TINY
     bool old_mark_set = openfile->mark_set;
@@ -682,7 +765,7 @@ ssize_t do_replace_loop(
 	whole_word_only,
 #endif
 	real_current, *real_current_x, needle, &match_len)) {
-	int i = 0;
+	int i;
 
 #ifndef NANO_TINY
 	if (old_mark_set) {
@@ -700,48 +783,16 @@ ssize_t do_replace_loop(
 	if (numreplaced == -1)
 	    numreplaced = 0;
 
-	if (!replaceall) {
-	    size_t xpt = xplustabs();
-	    char *exp_word = display_string(openfile->current->data,
-		xpt, strnlenpt(openfile->current->data,
-		openfile->current_x + match_len) - xpt, FALSE);
+	i = replace_occurrence(needle, match_len, &replaceall,
+		numreplaced == 0, &length_change);
 
-	    /* Refresh the edit window, scrolling it if necessary. */
-	    edit_refresh();
-
-	    /* Don't show cursor, to not distract from highlighted match. */
-	    curs_set(0);
-
-	    do_replace_highlight(TRUE, exp_word);
-
-	    /* TRANSLATORS: This is a prompt. */
-	    i = do_yesno_prompt(TRUE, _("Replace this instance?"));
-
-	    do_replace_highlight(FALSE, exp_word);
-
-	    free(exp_word);
-
-	    if (i == -1) {	/* We canceled the replace. */
-		if (canceled != NULL)
-		    *canceled = TRUE;
-		break;
-	    }
+	if (i == -1) {	/* We canceled the replace. */
+	    if (canceled != NULL)
+		*canceled = TRUE;
+	    break;
 	}
 
-	if (i > 0 || replaceall) {	/* Yes, replace it!!!! */
-	    char *copy;
-	    size_t length_change;
-
-#ifndef NANO_TINY
-	    add_undo(REPLACE);
-#endif
-	    if (i == 2)
-		replaceall = TRUE;
-
-	    copy = replace_line(needle);
-
-	    length_change = strlen(copy) - strlen(openfile->current->data);
-
+	if (i > 0) {	/* Yes, it was replaced. */
 #ifndef NANO_TINY
 	    /* If the mark was on and it was located after the cursor,
 	     * then adjust its x position for any text length changes. */
@@ -786,30 +837,6 @@ ssize_t do_replace_loop(
 #endif
 		openfile->current_x += match_len + length_change - 1;
 
-	    /* Update the file size, and put the changed line into place. */
-	    openfile->totsize += mbstrlen(copy) - mbstrlen(openfile->current->data);
-	    free(openfile->current->data);
-	    openfile->current->data = copy;
-
-#ifndef DISABLE_COLOR
-	    /* Reset the precalculated multiline-regex hints only when
-	     * the first replacement has been made. */
-	    if (numreplaced == 0)
-		reset_multis(openfile->current, TRUE);
-#endif
-
-	    if (!replaceall) {
-#ifndef DISABLE_COLOR
-		/* If color syntaxes are available and turned on, we
-		 * need to call edit_refresh(). */
-		if (openfile->colorstrings != NULL && !ISSET(NO_COLOR_SYNTAX))
-		    edit_refresh();
-		else
-#endif
-		    update_line(openfile->current, openfile->current_x);
-	    }
-
-	    set_modified();
 	    numreplaced++;
 	}
     }
@@ -838,7 +865,7 @@ void do_replace(void)
     ssize_t numreplaced;
     int i;
 
-    if (ISSET(VIEW_MODE)) {
+    if (in_view_mode()) {
 	print_view_warning();
 	search_replace_abort();
 	return;
@@ -1004,7 +1031,7 @@ void do_gotolinecolumn(ssize_t line, ssize_t column, bool use_answer,
 		openfile->current != openfile->filebot; line--)
 	openfile->current = openfile->current->next;
 
-    openfile->current_x = actual_x(openfile->current->data, column - 1);
+    openfile->current_x = line_actual_x(openfile->current, column - 1);
     openfile->placewewant = column - 1;
 
     /* Put the top line of the edit window in range of the current line. */
@@ -1221,6 +1248,18 @@ void history_init(void)
     replace_history->data = mallocstrcpy(NULL, "");
     replaceage = replace_history;
     replacebot = replace_history;
+
+    search_index.size = 64;
+    search_index.table = (filestruct **)nmalloc(search_index.size *
+	sizeof(filestruct *));
+    memset(search_index.table, 0, search_index.size *
+	sizeof(filestruct *));
+
+    replace_index.size = 64;
+    replace_index.table = (filestruct **)nmalloc(replace_index.size *
+	sizeof(filestruct *));
+    memset(replace_index.table, 0, replace_index.size *
+	sizeof(filestruct *));
 }
 
 /* Set the current position in the history list h to the bottom. */
@@ -1232,45 +1271,162 @@ void history_reset(const filestruct *h)
 	replace_history = replacebot;
 }
 
-/* Return the first node containing the first len characters of the
- * string s in the history list, starting at h_start and ending at
- * h_end, or NULL if there isn't one. */
-filestruct *find_history(const filestruct *h_start, const filestruct
-	*h_end, const char *s, size_t len)
+/* Return the home slot in the given history index for the string s. */
+size_t history_hash(const historyindex *index, const char *s)
 {
-    const filestruct *p;
+    size_t hash = 5381;
 
-    for (p = h_start; p != h_end->next && p != NULL; p = p->next) {
-	if (strncmp(s, p->data, len) == 0)
-	    return (filestruct *)p;
+    for (; *s != '\0'; s++)
+	hash = hash * 33 + (unsigned char)*s;
+
+    return hash & (index->size - 1);
+}
+
+/* Return the slot in the given history index that holds the string s,
+ * or the empty slot where it would go. */
+filestruct **history_slot(const historyindex *index, const char *s)
+{
+    filestruct **slot = &index->table[history_hash(index, s)];
+
+    while (*slot != NULL && strcmp((*slot)->data, s) != 0) {
+	if (++slot == index->table + index->size)
+	    slot = index->table;
     }
 
-    return NULL;
+    return slot;
 }
 
+/* Double the size of the hash table of the given history index. */
+void grow_history_index(historyindex *index)
+{
+    filestruct **old_table = index->table;
+    size_t old_size = index->size, i;
+
+    index->size *= 2;
+    index->table = (filestruct **)nmalloc(index->size *
+	sizeof(filestruct *));
+    memset(index->table, 0, index->size * sizeof(filestruct *));
+
+    for (i = 0; i < old_size; i++)
+	if (old_table[i] != NULL)
+	    *history_slot(index, old_table[i]->data) = old_table[i];
+
+    free(old_table);
+}
+
+/* Add the string in the given node to the given history index. */
+void remember_history(historyindex *index, filestruct *node)
+{
+    /* Keep the table at most half full. */
+    if ((index->count + 1) * 2 > index->size)
+	grow_history_index(index);
+
+    *history_slot(index, node->data) = node;
+    index->count++;
+    index->unsorted = TRUE;
+}
+
+/* Remove the string in the given node from the given history index.
+ * The strings further on in the same run of slots that would no longer
+ * be found from their home slot get moved back into the gap. */
+void forget_history(historyindex *index, const filestruct *node)
+{
+    filestruct **gap = history_slot(index, node->data), **slot = gap;
+
+    assert(*gap == node);
+
+    while (TRUE) {
+	filestruct **home;
+
+	if (++slot == index->table + index->size)
+	    slot = index->table;
+
+	if (*slot == NULL)
+	    break;
+
+	home = &index->table[history_hash(index, (*slot)->data)];
+
+	/* Move the string only when its home isn't past the gap. */
+	if ((gap < slot) ? (home <= gap || home > slot) :
+		(home <= gap && home > slot)) {
+	    *gap = *slot;
+	    gap = slot;
+	}
+    }
+
+    *gap = NULL;
+    index->count--;
+    index->unsorted = TRUE;
+}
+
+/* Compare two history strings, for sorting. */
+int history_compare(const void *va, const void *vb)
+{
+    const filestruct *a = *(const filestruct *const *)va;
+    const filestruct *b = *(const filestruct *const *)vb;
+
+    return strcmp(a->data, b->data);
+}
+
+/* Put the strings of the history list that starts at hage in sorted
+ * order in its index, if they aren't yet. */
+void sort_history(historyindex *index, filestruct *hage)
+{
+    size_t i;
+
+    if (!index->unsorted)
+	return;
+
+    index->sorted = (filestruct **)nrealloc(index->sorted,
+	(index->count + 1) * sizeof(filestruct *));
+
+    for (i = 0; i < index->count; i++, hage = hage->next)
+	index->sorted[i] = hage;
+
+    qsort(index->sorted, index->count, sizeof(filestruct *),
+	history_compare);
+
+    index->unsorted = FALSE;
+}
+
+#ifdef DEBUG
+/* Free the indexes of the history lists. */
+void free_history_indexes(void)
+{
+    free(search_index.table);
+    free(search_index.sorted);
+    free(replace_index.table);
+    free(replace_index.sorted);
+}
+#endif
+
 /* Update a history list.  h should be the current position in the
- * list. */
+ * list.  Finding an earlier copy of the string takes a single lookup
+ * in the index of the list. */
 void update_history(filestruct **h, const char *s)
 {
     filestruct **hage = NULL, **hbot = NULL, *p;
+    historyindex *index = NULL;
 
     assert(h != NULL && s != NULL);
 
     if (*h == search_history) {
 	hage = &searchage;
 	hbot = &searchbot;
+	index = &search_index;
     } else if (*h == replace_history) {
 	hage = &replaceage;
 	hbot = &replacebot;
+	index = &replace_index;
     }
 
-    assert(hage != NULL && hbot != NULL);
+    assert(hage != NULL && hbot != NULL && index != NULL);
 
     /* If this string is already in the history, delete it. */
-    p = find_history(*hage, *hbot, s, strlen(s));
+    p = *history_slot(index, s);
 
     if (p != NULL) {
-	filestruct *foo, *bar;
+	forget_history(index, p);
 
 	/* If the string is at the beginning, move the beginning down to
 	 * the next string. */
@@ -1278,25 +1434,24 @@ void update_history(filestruct **h, const char *s)
 	    *hage = (*hage)->next;
 
 	/* Delete the string. */
-	foo = p;
-	bar = p->next;
-	unlink_node(foo);
-	renumber(bar);
+	unlink_node(p);
     }
 
     /* If the history is full, delete the beginning entry to make room
-     * for the new entry at the end.  We assume that MAX_SEARCH_HISTORY
-     * is greater than zero. */
-    if ((*hbot)->lineno == MAX_SEARCH_HISTORY + 1) {
+     * for the new entry at the end.  We assume that history_length is
+     * greater than zero.  The line numbers aren't renumbered: they only
+     * need to increase toward the end. */
+    if ((ssize_t)index->count >= history_length) {
 	filestruct *foo = *hage;
 
+	forget_history(index, foo);
 	*hage = (*hage)->next;
 	unlink_node(foo);
-	renumber(*hage);
     }
 
     /* Add the new entry to the end. */
     (*hbot)->data = mallocstrcpy((*hbot)->data, s);
+    remember_history(index, *hbot);
     splice_node(*hbot, make_new_node(*hbot));
     *hbot = (*hbot)->next;
     (*hbot)->data = mallocstrcpy(NULL, "");
@@ -1308,6 +1463,62 @@ void update_history(filestruct **h, const char *s)
     *h = *hbot;
 }
 
+/* Fill the empty history list h with the given strings, from the oldest
+ * to the newest, with the same result as adding each of them in turn:
+ * only the newest copy of a string is kept, and only the newest
+ * history_length strings.  This takes a single pass over the strings,
+ * from the newest backward.  The strings are taken over. */
+void fill_history(filestruct **h, char **strings, size_t count)
+{
+    filestruct **hage = NULL, **hbot = NULL, *top;
+    historyindex *index = NULL;
+
+    assert(h != NULL && (strings != NULL || count == 0));
+
+    if (*h == search_history) {
+	hage = &searchage;
+	hbot = &searchbot;
+	index = &search_index;
+    } else if (*h == replace_history) {
+	hage = &replaceage;
+	hbot = &replacebot;
+	index = &replace_index;
+    }
+
+    assert(hage != NULL && hbot != NULL && index != NULL &&
+		*hage == *hbot);
+
+    top = *hbot;
+
+    for (; count > 0 && (ssize_t)index->count < history_length; count--) {
+	char *s = strings[count - 1];
+
+	if (*history_slot(index, s) != NULL) {
+	    free(s);
+	    continue;
+	}
+
+	top->prev = make_new_node(NULL);
+	top->prev->next = top;
+	top = top->prev;
+	top->data = s;
+
+	remember_history(index, top);
+    }
+
+    /* Drop the strings that didn't fit anymore. */
+    for (; count > 0; count--)
+	free(strings[count - 1]);
+
+    if (top != *hbot) {
+	*hage = top;
+	renumber(top);
+	history_changed = TRUE;
+    }
+
+    *h = *hbot;
+}
+
 /* Move h to the string in the history list just before it, and return
  * that string.  If there isn't one, don't move h and return NULL. */
 char *get_history_older(filestruct **h)
@@ -1356,39 +1567,56 @@ char *get_history_completion(filestruct **h, char *s, size_t len)
     assert(s != NULL);
 
     if (len > 0) {
-	filestruct *hage = NULL, *hbot = NULL, *p;
+	filestruct *hage = NULL, *p = NULL, *first = NULL;
+	historyindex *index = NULL;
+	size_t low = 0, high;
 
 	assert(h != NULL);
 
 	if (*h == search_history) {
 	    hage = searchage;
-	    hbot = searchbot;
+	    index = &search_index;
 	} else if (*h == replace_history) {
 	    hage = replaceage;
-	    hbot = replacebot;
+	    index = &replace_index;
 	}
 
-	assert(hage != NULL && hbot != NULL);
+	assert(hage != NULL && index != NULL);
 
-	/* Search the history list from the current position to the
-	 * bottom for a match of len characters.  Skip over an exact
-	 * match. */
-	p = find_history((*h)->next, hbot, s, len);
+	sort_history(index, hage);
 
-	while (p != NULL && strcmp(p->data, s) == 0)
-	    p = find_history(p->next, hbot, s, len);
+	/* Find the first of the sorted strings that match len
+	 * characters; the others follow it. */
+	high = index->count;
+	while (low < high) {
+	    size_t middle = low + (high - low) / 2;
 
-	if (p != NULL) {
-	    *h = p;
-	    return mallocstrcpy(s, (*h)->data);
+	    if (strncmp(index->sorted[middle]->data, s, len) < 0)
+		low = middle + 1;
+	    else
+		high = middle;
 	}
 
-	/* Search the history list from the top to the current position
-	 * for a match of len characters.  Skip over an exact match. */
-	p = find_history(hage, *h, s, len);
+	/* Of the matches, skipping over an exact match, take the first
+	 * one after the current position, or else the first one from
+	 * the top of the history list.  Line numbers tell the order. */
+	for (; low < index->count && strncmp(index->sorted[low]->data,
+		s, len) == 0; low++) {
+	    filestruct *match = index->sorted[low];
+
+	    if (strcmp(match->data, s) == 0)
+		continue;
+
+	    if (match->lineno > (*h)->lineno && (p == NULL ||
+		match->lineno < p->lineno))
+		p = match;
+
+	    if (first == NULL || match->lineno < first->lineno)
+		first = match;
+	}
 
-	while (p != NULL && strcmp(p->data, s) == 0)
-	    p = find_history(p->next, *h, s, len);
+	if (p == NULL)
+	    p = first;
 
 	if (p != NULL) {
 	    *h = p;
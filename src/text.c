@@ -33,8 +33,65 @@
 
 #ifndef NANO_TINY
 static pid_t pid = -1;
-	/* The PID of the forked process in execute_command(), for use
-	 * with the cancel_command() signal handler. */
+	/* The PID of the command whose output is being inserted. */
+static pid_t lingering_pid = -1;
+	/* The PID of a command that closed its output but hadn't ended. */
+static feedstruct command_feed;
+	/* Where that output goes, and its incomplete last line. */
+static size_t command_total = 0;
+	/* The number of bytes of output so far. */
+static bool command_in_place = FALSE;
+	/* Whether the output goes into the buffer the command was run
+	 * from, instead of into a new one. */
+static bool command_filtering = FALSE;
+	/* Whether the output replaces the text that was piped through
+	 * the command. */
+static size_t command_pww = 0;
+	/* The place we wanted when the command was started. */
+static size_t command_numbered = 0;
+	/* How many lines of output there were when the lines after them
+	 * were last renumbered. */
+static undo *command_undo = NULL;
+	/* The undo item for the insertion of the output. */
+static filestruct *command_input = NULL;
+	/* The text for the command's standard input, if any. */
+static const filestruct *input_line = NULL;
+static size_t input_x = 0;
+	/* The place in that text from where to gather more. */
+static char input_piece[BUFSIZ * 8];
+	/* The piece of that text that is waiting to be written. */
+static size_t input_pos = 0, input_len = 0;
+	/* What part of the piece has been written already, and its size. */
+static RETSIGTYPE (*command_oldpipe)(int) = SIG_DFL;
+	/* The previous handler for SIGPIPE. */
+#endif
+#ifndef DISABLE_COLOR
+static pid_t lint_pid = -1;
+	/* The PID of the linter that runs in the background. */
+static int lint_status;
+	/* How that linter exited. */
+static openfilestruct *lint_buffer = NULL;
+	/* The buffer whose file the last lint run was for. */
+static char *lint_command = NULL;
+	/* The linter command of that run, for messages. */
+static lintstruct *lints = NULL, *last_lint = NULL;
+	/* The messages of that run so far. */
+static size_t lint_count = 0;
+	/* And how many there are. */
+static char *lint_line = NULL;
+	/* The line of linter output that hasn't been completed yet. */
+static size_t lint_len = 0, lint_size = 0;
+	/* Its length, and the number of bytes allocated for it. */
+#endif
+#ifndef DISABLE_SPELLER
+static spellword *spell_words = NULL;
+	/* The words that the spell checker flagged, in order. */
+static size_t spell_count = 0;
+	/* The number of those words. */
+static spellword **spell_table = NULL;
+	/* The hash table of the keys of those words. */
+static size_t spell_table_size = 0;
+	/* The number of slots in that table; a power of two. */
 #endif
 #ifndef DISABLE_WRAPPING
 static bool prepend_wrap = FALSE;
@@ -79,7 +136,7 @@ char *invocation_error(const char *name)
 void do_deletion(undo_type action)
 {
 #ifndef NANO_TINY
-    size_t orig_lenpt = 0;
+    size_t orig_lenpt = 0, removed = 0, stamp = (size_t)-1;
 #endif
 
     assert(openfile->current != NULL && openfile->current->data != NULL &&
@@ -87,6 +144,12 @@ void do_deletion(undo_type action)
 
     openfile->placewewant = xplustabs();
 
+#ifndef NANO_TINY
+    /* If the line is a long one, its index is current now. */
+    if (chunks_current(openfile->current))
+	stamp = edit_stamp;
+#endif
+
     if (openfile->current->data[openfile->current_x] != '\0') {
 	int char_buf_len = parse_mbchar(openfile->current->data +
 		openfile->current_x, NULL, NULL);
@@ -99,7 +162,7 @@ void do_deletion(undo_type action)
 	update_undo(action);
 
 	if (ISSET(SOFTWRAP))
-	    orig_lenpt = strlenpt(openfile->current->data);
+	    orig_lenpt = line_width(openfile->current);
 #endif
 
 	/* Let's get dangerous. */
@@ -113,6 +176,8 @@ void do_deletion(undo_type action)
 	if (openfile->mark_set && openfile->mark_begin == openfile->current &&
 		openfile->current_x < openfile->mark_begin_x)
 	    openfile->mark_begin_x -= char_buf_len;
+
+	removed = char_buf_len;
 #endif
 	openfile->totsize--;
     } else if (openfile->current != openfile->filebot) {
@@ -154,13 +219,18 @@ void do_deletion(undo_type action)
     } else
 	return;
 
+    set_modified();
+
 #ifndef NANO_TINY
+    if (removed > 0)
+	update_chunks(openfile->current, stamp, openfile->current_x,
+		removed, 0);
+
+    /* The line was marked as changed, so its width is measured anew. */
     if (ISSET(SOFTWRAP) && edit_refresh_needed == FALSE)
-	if (strlenpt(openfile->current->data) / COLS != orig_lenpt / COLS)
+	if (line_width(openfile->current) / COLS != orig_lenpt / COLS)
 	    edit_refresh_needed = TRUE;
 #endif
-
-    set_modified();
 }
 
 /* Delete the character under the cursor. */
@@ -476,6 +546,8 @@ void do_undo(void)
 	return;
     }
 
+    edit_stamp++;
+
     filestruct *f = fsfromline(u->mark_begin_lineno);
     if (!f) {
 	statusbar(_("Internal error: can't match line %d.  "
@@ -524,6 +596,17 @@ void do_undo(void)
 	undidmsg = _("text add");
 	break;
 #endif
+    case FILTER_END:
+	goto_line_posx(u->lineno, u->begin);
+	openfile->current_undo = openfile->current_undo->next;
+	openfile->last_action = OTHER;
+	while (openfile->current_undo->type != FILTER_BEGIN)
+	    do_undo();
+	u = openfile->current_undo;
+	f = openfile->current;
+    case FILTER_BEGIN:
+	undidmsg = _("filtering");
+	break;
     case JOIN:
 	undidmsg = _("line join");
 	/* When the join was done by a Backspace at the tail of the file,
@@ -620,6 +703,8 @@ void do_redo(void)
 	return;
     }
 
+    edit_stamp++;
+
     /* Get the previous undo item. */
     while (u != NULL && u->next != openfile->current_undo)
 	u = u->next;
@@ -686,6 +771,17 @@ void do_redo(void)
 	redidmsg = _("text add");
 	break;
 #endif
+    case FILTER_BEGIN:
+	goto_line_posx(u->lineno, u->begin);
+	openfile->current_undo = u;
+	openfile->last_action = OTHER;
+	while (openfile->current_undo->type != FILTER_END)
+	    do_redo();
+	u = openfile->current_undo;
+	goto_line_posx(u->lineno, u->begin);
+    case FILTER_END:
+	redidmsg = _("filtering");
+	break;
     case JOIN:
 	if (f->next == NULL) {
 	    statusbar(_("Internal error: line is missing.  Please save your work."));
@@ -803,24 +899,115 @@ void do_enter()
 }
 
 #ifndef NANO_TINY
-/* Send a SIGKILL (unconditional kill) to the forked process in
- * execute_command(). */
-RETSIGTYPE cancel_command(int signal)
+/* Show how much output the running command has produced so far. */
+void report_command_output(size_t total)
 {
-    if (kill(pid, SIGKILL) == -1)
-	nperror("kill");
+    statusbar(P_("Executing... %lu byte read (^C to cancel)",
+	"Executing... %lu bytes read (^C to cancel)",
+	(unsigned long)total), (unsigned long)total);
+}
+
+/* Take the marked text out of the current buffer, or all of it when
+ * nothing is marked, so that it can be piped through a command.  When
+ * cut is TRUE the text is removed, as an undoable cut that leaves the
+ * cutbuffer alone, and otherwise it is copied.  The caller should free
+ * the result. */
+filestruct *take_piped_text(bool cut)
+{
+    filestruct *oldcutbuffer = cutbuffer, *oldcutbottom = cutbottom;
+    filestruct *text;
+    ssize_t was_edittop_lineno = openfile->edittop->lineno;
+    ssize_t was_current_lineno = openfile->current->lineno;
+    size_t was_current_x = openfile->current_x;
+
+    if (!openfile->mark_set) {
+	openfile->mark_set = TRUE;
+	openfile->mark_begin = openfile->fileage;
+	openfile->mark_begin_x = 0;
+	openfile->current = openfile->filebot;
+	openfile->current_x = strlen(openfile->filebot->data);
+    }
+
+    cutbuffer = NULL;
+    cutbottom = NULL;
+
+    if (cut) {
+	add_undo(CUT);
+	do_cut_text(FALSE, FALSE);
+	update_undo(CUT);
+    } else {
+	do_cut_text(TRUE, FALSE);
+
+	/* Restore the view port and cursor position. */
+	openfile->edittop = fsfromline(was_edittop_lineno);
+	openfile->current = fsfromline(was_current_lineno);
+	openfile->current_x = was_current_x;
+    }
+
+    text = cutbuffer;
+    cutbuffer = oldcutbuffer;
+    cutbottom = oldcutbottom;
+    cutbuffer_reset();
+
+    /* An empty region still means an empty line of input. */
+    if (text == NULL) {
+	text = make_new_node(NULL);
+	text->data = mallocstrcpy(NULL, "");
+    }
+
+    return text;
+}
+
+/* Copy as much of the text from *line at *x onward into buf as fits in
+ * size bytes, turning the lines back into newline-separated text, and
+ * advance *line and *x past what was copied.  Return the number of
+ * bytes copied. */
+size_t gather_piped_text(const filestruct **line, size_t *x, char *buf,
+	size_t size)
+{
+    size_t count = 0;
+
+    while (*line != NULL && count < size) {
+	size_t len = strnlen((*line)->data + *x, size - count);
+	char *nl = buf + count;
+
+	memcpy(buf + count, (*line)->data + *x, len);
+	count += len;
+	*x += len;
+
+	/* Newlines inside a line are stored as nulls. */
+	while ((nl = memchr(nl, '\n', buf + count - nl)) != NULL)
+	    *nl++ = '\0';
+
+	if ((*line)->data[*x] != '\0' || count == size)
+	    break;
+
+	if ((*line)->next != NULL)
+	    buf[count++] = '\n';
+
+	*line = (*line)->next;
+	*x = 0;
+    }
+
+    return count;
 }
 
-/* Execute command in a shell.  Return TRUE on success. */
-bool execute_command(const char *command)
+/* Execute command in a shell in the background, and have its output
+ * inserted at the cursor as it arrives, by handle_command_output().
+ * When input isn't NULL, the command gets those lines on its standard
+ * input, and they are taken over.  When in_place is TRUE, the output
+ * goes into the buffer that the command is run from, which puts the
+ * cursor after it at the end; with input, the output replaces that.
+ * Return TRUE when the command was started. */
+bool execute_command(const char *command, filestruct *input,
+	bool in_place)
 {
-    int fd[2];
-    FILE *f;
+    int fd[2], in_fd[2] = {-1, -1};
     char *shellenv;
-    struct sigaction oldaction, newaction;
-	/* Original and temporary handlers for SIGINT. */
-    bool sig_failed = FALSE;
-	/* Did sigaction() fail without changing the signal handlers? */
+
+    /* Only one command runs at a time. */
+    if (command_fd != -1)
+	stop_command();
 
     /* Make our pipes. */
     if (pipe(fd) == -1) {
@@ -828,6 +1015,13 @@ bool execute_command(const char *command)
 	return FALSE;
     }
 
+    if (input != NULL && pipe(in_fd) == -1) {
+	close(fd[0]);
+	close(fd[1]);
+	statusbar(_("Could not create pipe"));
+	return FALSE;
+    }
+
     /* Check $SHELL for the shell to use.  If it isn't set, use /bin/sh.
      * Note that $SHELL should contain only a path, with no arguments. */
     shellenv = getenv("SHELL");
@@ -839,6 +1033,22 @@ bool execute_command(const char *command)
 	close(fd[0]);
 	dup2(fd[1], fileno(stdout));
 	dup2(fd[1], fileno(stderr));
+	close(fd[1]);
+
+	if (input != NULL) {
+	    close(in_fd[1]);
+	    dup2(in_fd[0], fileno(stdin));
+	    close(in_fd[0]);
+	} else {
+	    int nullfd = open("/dev/null", O_RDONLY);
+
+	    /* Keep the command away from the keyboard, as we go on
+	     * reading it meanwhile. */
+	    if (nullfd != -1) {
+		dup2(nullfd, fileno(stdin));
+		close(nullfd);
+	    }
+	}
 
 	/* If execl() returns at all, there was an error. */
 	execl(shellenv, tail(shellenv), "-c", command, NULL);
@@ -848,51 +1058,275 @@ bool execute_command(const char *command)
     /* Continue as parent. */
     close(fd[1]);
 
+    if (input != NULL)
+	close(in_fd[0]);
+
     if (pid == -1) {
 	close(fd[0]);
+	if (input != NULL)
+	    close(in_fd[1]);
 	statusbar(_("Could not fork"));
 	return FALSE;
     }
 
-    /* Before we start reading the forked command's output, we set
-     * things up so that Ctrl-C will cancel the new process. */
+    /* Read the output without blocking, so that typing can go on. */
+    if (fcntl(fd[0], F_SETFL, fcntl(fd[0], F_GETFL) | O_NONBLOCK) == -1)
+	nperror("fcntl");
+
+    /* Write the input without blocking too, so that neither side can
+     * get stuck on a full pipe.  A command that quits without reading
+     * everything shouldn't kill us. */
+    if (input != NULL) {
+	if (fcntl(in_fd[1], F_SETFL, fcntl(in_fd[1], F_GETFL) | O_NONBLOCK) == -1)
+	    nperror("fcntl");
+	command_oldpipe = signal(SIGPIPE, SIG_IGN);
+    }
 
-    /* Enable interpretation of the special control keys so that we get
-     * SIGINT when Ctrl-C is pressed. */
-    enable_signals();
+    command_fd = fd[0];
+    command_input_fd = in_fd[1];
+    command_input = input;
+    input_line = input;
+    input_x = 0;
+    input_pos = 0;
+    input_len = 0;
+
+    memset(&command_feed, 0, sizeof(feedstruct));
+    command_feed.buffer = openfile;
+    command_feed.keep_top = TRUE;
+    command_feed.spot = openfile->current;
+    command_feed.spot_x = openfile->current_x;
+    command_feed.midway = (in_place && input != NULL &&
+			openfile->current != openfile->filebot);
+
+    command_total = 0;
+    command_numbered = 0;
+    command_in_place = in_place;
+    command_filtering = (in_place && input != NULL);
+    command_pww = openfile->placewewant;
+
+    add_undo(INSERT);
+    command_undo = openfile->current_undo;
+
+    report_command_output(0);
 
-    if (sigaction(SIGINT, NULL, &newaction) == -1) {
-	sig_failed = TRUE;
-	nperror("sigaction");
-    } else {
-	newaction.sa_handler = cancel_command;
-	if (sigaction(SIGINT, &newaction, &oldaction) == -1) {
-	    sig_failed = TRUE;
-	    nperror("sigaction");
+    return TRUE;
+}
+
+/* Stop writing to the running command, and let go of its input. */
+void end_command_input(void)
+{
+    if (command_input_fd != -1) {
+	close(command_input_fd);
+	command_input_fd = -1;
+	signal(SIGPIPE, command_oldpipe);
+    }
+
+    free_filestruct(command_input);
+    command_input = NULL;
+    input_line = NULL;
+}
+
+/* Write as much of the piped text to the running command as it takes
+ * right now, and stop when all of it has been written or the command
+ * doesn't want (more of) it. */
+void handle_command_input(void)
+{
+    while (command_input_fd != -1) {
+	ssize_t sent;
+
+	if (input_pos == input_len) {
+	    input_pos = 0;
+	    input_len = gather_piped_text(&input_line, &input_x,
+			input_piece, sizeof(input_piece));
+	    if (input_len == 0) {
+		end_command_input();
+		break;
+	    }
+	}
+
+	sent = write(command_input_fd, input_piece + input_pos,
+			input_len - input_pos);
+
+	if (sent < 0) {
+	    if (errno == EINTR)
+		continue;
+	    /* Anything other than a full pipe means the command
+	     * doesn't want (more) input. */
+	    if (errno != EAGAIN && errno != EWOULDBLOCK)
+		end_command_input();
+	    break;
+	}
+
+	input_pos += sent;
+    }
+}
+
+/* Give the lines after the output that was inserted so far their new
+ * numbers, if lines were added since the last time. */
+void number_command_output(void)
+{
+    if (command_fd != -1 && command_feed.lines != command_numbered) {
+	renumber(command_feed.spot);
+	command_numbered = command_feed.lines;
+    }
+}
+
+/* Read in whatever output the running command has produced, up to
+ * STDIN_BATCH bytes at a time, so that keystrokes don't have to wait
+ * long, and insert it.  At the end of the output, finish up.  Return
+ * TRUE when the visible part of the current buffer may have changed. */
+bool handle_command_output(void)
+{
+    char chunk[BUFSIZ * 8];
+    openfilestruct *buffer = command_feed.buffer;
+    filestruct *spot = command_feed.spot;
+    bool onscreen = (buffer == openfile &&
+		spot->lineno >= openfile->edittop->lineno &&
+		spot->lineno < openfile->edittop->lineno + editwinrows);
+    size_t total = 0;
+    ssize_t got = 0;
+
+    while (total < STDIN_BATCH) {
+	got = read(command_fd, chunk, sizeof(chunk));
+
+	if (got <= 0)
+	    break;
+
+	feed_text(&command_feed, chunk, got);
+	total += got;
+    }
+
+    command_total += total;
+
+    if (got == 0 || (got < 0 && errno != EAGAIN &&
+		errno != EWOULDBLOCK && errno != EINTR)) {
+	if (got < 0)
+	    nperror("read");
+	finish_command();
+	return (buffer == openfile);
+    }
+
+    if (total > 0 && currmenu == MMAIN) {
+	report_command_output(command_total);
+	curs_set(1);
+    }
+
+    /* The lines below the output are numbered anew only when they can
+     * be seen, or when a keystroke comes. */
+    if (onscreen)
+	number_command_output();
+
+    return onscreen;
+}
+
+/* Finish the insertion of the output of the command that has ended or
+ * was killed: add its incomplete last line, collect the command when it
+ * is done, and complete the undo item for the insertion. */
+void finish_command(void)
+{
+    openfilestruct *was_openfile = openfile;
+
+    close(command_fd);
+    command_fd = -1;
+    end_command_input();
+
+    /* A command may close its output and keep running; don't wait for
+     * it, but collect it later from the main loop.  One that lingered
+     * before is not waited for any longer. */
+    if (waitpid(pid, NULL, WNOHANG) == 0) {
+	if (lingering_pid != -1) {
+	    kill(lingering_pid, SIGKILL);
+	    waitpid(lingering_pid, NULL, 0);
 	}
+	lingering_pid = pid;
     }
 
-    /* Note that now oldaction is the previous SIGINT signal handler,
-     * to be restored later. */
+    /* The buffer may not be the current one anymore, while the undo
+     * code works on the current one. */
+    openfile = command_feed.buffer;
 
-    f = fdopen(fd[0], "rb");
-    if (f == NULL)
-	nperror("fdopen");
+    finish_feed(&command_feed);
+    renumber(command_feed.spot);
 
-    read_file(f, 0, "stdin", TRUE, FALSE);
+    /* Let the undo item know where the insertion ends, as a number of
+     * lines (plus one) and an x position. */
+    command_undo->newsize = openfile->totsize;
+    command_undo->mark_begin_lineno = command_feed.spot->lineno -
+		command_undo->lineno + 1;
+    command_undo->mark_begin_x = command_feed.spot_x;
 
-    if (wait(NULL) == -1)
-	nperror("wait");
+    if (command_in_place) {
+	/* Like after inserting a file, the place we want stays. */
+	openfile->current = command_feed.spot;
+	openfile->current_x = command_feed.spot_x;
+	openfile->placewewant = command_pww;
 
-    if (!sig_failed && sigaction(SIGINT, &oldaction, NULL) == -1)
-	nperror("sigaction");
+	if (command_feed.lines > 0)
+	    set_modified();
 
-    /* Restore the terminal to its previous state.  In the process,
-     * disable interpretation of the special control keys so that we can
-     * use Ctrl-C for other things. */
-    terminal_init();
+	if (command_filtering)
+	    add_undo(FILTER_END);
+    }
 
-    return TRUE;
+    set_feed_format(openfile, command_feed.format);
+
+    openfile = was_openfile;
+
+    if (currmenu == MMAIN) {
+	if (openfile != command_feed.buffer)
+	    titlebar(NULL);
+	report_feed(&command_feed);
+    }
+
+    command_feed.buffer = NULL;
+}
+
+/* Kill the running command, and insert what it has produced so far. */
+void stop_command(void)
+{
+    if (kill(pid, SIGKILL) == -1)
+	nperror("kill");
+
+    finish_command();
+}
+
+/* Kill the running command when the given buffer, into which its output
+ * goes, is going away, and discard the rest of the output. */
+void forget_command(const openfilestruct *buffer)
+{
+    if (command_fd == -1 || buffer != command_feed.buffer)
+	return;
+
+    kill(pid, SIGKILL);
+    close(command_fd);
+    command_fd = -1;
+    end_command_input();
+    waitpid(pid, NULL, 0);
+
+    free(command_feed.line);
+    command_feed.buffer = NULL;
+}
+
+/* Return TRUE when a command has closed its output but hadn't ended
+ * yet when last looked at. */
+bool command_lingers(void)
+{
+    return (lingering_pid != -1);
+}
+
+/* Collect the command that lingered after closing its output, when it
+ * has ended by now. */
+void reap_command(void)
+{
+    if (lingering_pid != -1 && waitpid(lingering_pid, NULL, WNOHANG) != 0)
+	lingering_pid = -1;
+}
+
+/* Return TRUE when the output of a command is still coming into the
+ * current buffer. */
+bool running_command(void)
+{
+    return (command_fd != -1 && openfile == command_feed.buffer);
 }
 
 /* Discard undo items that are newer than the given one, or all if NULL. */
@@ -918,6 +1352,9 @@ void add_undo(undo_type action)
     undo *u = openfile->current_undo;
 	/* The thing we did previously. */
 
+    /* An undoable change is about to be made or has just been made. */
+    edit_stamp++;
+
     /* When doing contiguous adds or contiguous cuts -- which means: with
      * no cursor movement in between -- don't add a new undo item. */
     if (u && u->mark_begin_lineno == openfile->current->lineno && action == openfile->last_action &&
@@ -999,6 +1436,11 @@ void add_undo(undo_type action)
     case SPLIT_END:
 	break;
 #endif
+    case FILTER_BEGIN:
+	break;
+    case FILTER_END:
+	u->newsize = openfile->totsize;
+	break;
     case INSERT:
 	break;
     case REPLACE:
@@ -1055,6 +1497,8 @@ fprintf(stderr, "  >> Updating... action = %d, openfile->last_action = %d, openf
 	    fprintf(stderr, "\n");
 #endif
 
+    edit_stamp++;
+
     /* Change to an add if we're not using the same undo struct
      * that we should be using. */
     if (action != openfile->last_action ||
@@ -1077,7 +1521,10 @@ fprintf(stderr, "  >> Updating... action = %d, openfile->last_action = %d, openf
 #endif
 	char *char_buf = charalloc(mb_cur_max());
 	size_t char_buf_len = parse_mbchar(&openfile->current->data[u->mark_begin_x], char_buf, NULL);
-	u->strdata = addstrings(u->strdata, u->strdata ? strlen(u->strdata) : 0, char_buf, char_buf_len);
+	/* An add is only continued where it left off, at mark_begin_x,
+	 * so the text gathered so far is the mark_begin_x - begin bytes
+	 * from begin on; this avoids a strlen() of it for each character. */
+	u->strdata = addstrings(u->strdata, u->mark_begin_x - u->begin, char_buf, char_buf_len);
 #ifdef DEBUG
 	fprintf(stderr, "  >> current undo data is \"%s\"\n", u->strdata);
 #endif
@@ -1167,6 +1614,8 @@ fprintf(stderr, "  >> Updating... action = %d, openfile->last_action = %d, openf
     case SPLIT_BEGIN:
     case SPLIT_END:
 #endif
+    case FILTER_BEGIN:
+    case FILTER_END:
     case JOIN:
 	/* These cases are handled by the earlier check for a new line and action. */
 	break;
@@ -2337,24 +2786,217 @@ void do_full_justify(void)
 #endif /* !DISABLE_JUSTIFY */
 
 #ifndef DISABLE_SPELLER
-/* A word is misspelled in the file.  Let the user replace it.  We
- * return FALSE if the user cancels. */
-bool do_int_spell_fix(const char *word)
+/* Return the length in bytes of the run of word characters that
+ * starts at text. */
+size_t word_run_length(const char *text)
+{
+    const char *ptr = text;
+
+    while (*ptr != '\0' && is_word_mbchar(ptr, FALSE))
+	ptr += parse_mbchar(ptr, NULL, NULL);
+
+    return ptr - text;
+}
+
+/* Return the slot in the table of flagged words for the given key of
+ * len bytes. */
+size_t spell_hash(const char *key, size_t len)
+{
+    size_t hash = 5381;
+
+    while (len-- > 0)
+	hash = hash * 33 + (unsigned char)*key++;
+
+    return hash & (spell_table_size - 1);
+}
+
+/* Return the first flagged word whose key is the given run of len
+ * bytes, or NULL if there is none. */
+spellword *find_spell_key(const char *key, size_t len)
+{
+    spellword **slot = &spell_table[spell_hash(key, len)];
+
+    while (*slot != NULL) {
+	if ((*slot)->keylen == len && strncmp((*slot)->word, key, len) == 0)
+	    return *slot;
+	if (++slot == spell_table + spell_table_size)
+	    slot = spell_table;
+    }
+
+    return NULL;
+}
+
+/* Add the given line to the lines of the given flagged word, keeping
+ * them in order, unless it is among them already. */
+void add_spell_line(spellword *entry, filestruct *line)
+{
+    size_t lo = 0, hi = entry->count;
+
+    /* The index is built from the top down, so mostly the line goes at
+     * the end. */
+    if (hi > 0 && entry->lines[hi - 1]->lineno < line->lineno)
+	lo = hi;
+
+    while (lo < hi) {
+	size_t mid = (lo + hi) / 2;
+
+	if (entry->lines[mid]->lineno < line->lineno)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    if (lo < entry->count && entry->lines[lo] == line)
+	return;
+
+    if (entry->count == entry->size) {
+	entry->size = entry->size * 2 + 4;
+	entry->lines = (filestruct **)nrealloc(entry->lines,
+		entry->size * sizeof(filestruct *));
+    }
+
+    memmove(entry->lines + lo + 1, entry->lines + lo,
+	(entry->count - lo) * sizeof(filestruct *));
+    entry->lines[lo] = line;
+    entry->count++;
+}
+
+/* Note the given line under each flagged word from number first onward
+ * whose key occurs as a whole word in the given text. */
+void index_spell_text(filestruct *line, const char *text, size_t first)
+{
+    while (*text != '\0') {
+	size_t len = word_run_length(text);
+	spellword *entry;
+
+	if (len == 0) {
+	    text += parse_mbchar(text, NULL, NULL);
+	    continue;
+	}
+
+	for (entry = find_spell_key(text, len); entry != NULL;
+		entry = entry->same_key) {
+	    if ((size_t)(entry - spell_words) >= first)
+		add_spell_line(entry, line);
+	}
+
+	text += len;
+    }
+}
+
+/* Split the given list of misspelled words into its words, and find in
+ * a single pass over the buffer the lines where each of them may occur.
+ * A word is indexed under its leading run of word characters, and is
+ * only looked for on the lines where that run occurs as a whole word. */
+void build_spell_index(char *list)
+{
+    char *ptr;
+    size_t keyless = 0, i;
+    filestruct *line;
+
+    spell_count = 0;
+    for (ptr = list; *ptr != '\0'; ptr++) {
+	if ((ptr == list || ptr[-1] == '\0') && *ptr != '\r' && *ptr != '\n')
+	    spell_count++;
+	if (*ptr == '\r' || *ptr == '\n')
+	    *ptr = '\0';
+    }
+
+    ptr = list;
+
+    spell_words = (spellword *)nmalloc((spell_count + 1) * sizeof(spellword));
+
+    for (spell_table_size = 16; spell_table_size < spell_count * 2;)
+	spell_table_size *= 2;
+    spell_table = (spellword **)nmalloc(spell_table_size * sizeof(spellword *));
+    memset(spell_table, 0, spell_table_size * sizeof(spellword *));
+
+    for (i = 0; i < spell_count; i++) {
+	spellword *entry = &spell_words[i];
+
+	while (*ptr == '\0')
+	    ptr++;
+
+	entry->word = ptr;
+	entry->keylen = word_run_length(ptr);
+	entry->lines = NULL;
+	entry->count = 0;
+	entry->size = 0;
+	entry->same_key = NULL;
+
+	ptr += strlen(ptr);
+
+	if (entry->keylen == 0) {
+	    keyless++;
+	    continue;
+	}
+
+	/* Words with the same key are chained to the first one. */
+	if ((entry->same_key = find_spell_key(entry->word,
+		entry->keylen)) != NULL) {
+	    spellword *first = entry->same_key;
+
+	    entry->same_key = first->same_key;
+	    first->same_key = entry;
+	} else {
+	    spellword **slot = &spell_table[spell_hash(entry->word,
+		entry->keylen)];
+
+	    while (*slot != NULL) {
+		if (++slot == spell_table + spell_table_size)
+		    slot = spell_table;
+	    }
+	    *slot = entry;
+	}
+    }
+
+    for (line = openfile->fileage; line != NULL; line = line->next) {
+	index_spell_text(line, line->data, 0);
+
+	/* A word without a key may occur anywhere. */
+	for (i = 0; keyless > 0 && i < spell_count; i++) {
+	    if (spell_words[i].keylen == 0)
+		add_spell_line(&spell_words[i], line);
+	}
+    }
+}
+
+/* Free the index of misspelled words. */
+void free_spell_index(void)
+{
+    size_t i;
+
+    for (i = 0; i < spell_count; i++)
+	free(spell_words[i].lines);
+
+    free(spell_words);
+    spell_words = NULL;
+    free(spell_table);
+    spell_table = NULL;
+    spell_count = 0;
+}
+
+/* A word is misspelled in the file.  Let the user replace it, visiting
+ * only the lines where the index says it occurs.  We return FALSE if
+ * the user cancels. */
+bool do_int_spell_fix(spellword *entry)
 {
-    char *save_search, *save_replace;
-    size_t match_len, current_x_save = openfile->current_x;
+    const char *word = entry->word;
+    size_t word_len = strlen(word), numreplaced = 0, length_change, i;
+    size_t current_x_save = openfile->current_x;
     size_t pww_save = openfile->placewewant;
     filestruct *edittop_save = openfile->edittop;
     filestruct *current_save = openfile->current;
 	/* Save where we are. */
     bool canceled = FALSE;
 	/* The return value. */
+    bool prompted = FALSE, finished = FALSE, replaceall = FALSE;
+	/* Whether the user was asked for a replacement, whether there is
+	 * nothing more to do, and whether to replace without asking. */
     unsigned stash[sizeof(flags) / sizeof(flags[0])];
 	/* A storage place for the current flag settings. */
 #ifndef NANO_TINY
     bool old_mark_set = openfile->mark_set;
-    bool added_magicline = FALSE;
-	/* Whether we added a magicline after filebot. */
     bool right_side_up = FALSE;
 	/* TRUE if (mark_begin, mark_begin_x) is the top of the mark,
 	 * FALSE if (current, current_x) is. */
@@ -2365,26 +3007,11 @@ bool do_int_spell_fix(const char *word)
     /* Save the settings of the global flags. */
     memcpy(stash, flags, sizeof(flags));
 
-    /* Make sure spell-check is case sensitive. */
-    SET(CASE_SENSITIVE);
-
-#ifndef NANO_TINY
-    /* Make sure spell-check goes forward only. */
-    UNSET(BACKWARDS_SEARCH);
-#endif
 #ifdef HAVE_REGEX_H
     /* Make sure spell-check doesn't use regular expressions. */
     UNSET(USE_REGEXP);
 #endif
 
-    /* Save the current search/replace strings. */
-    save_search = last_search;
-    save_replace = last_replace;
-
-    /* Set the search/replace strings to the misspelled word. */
-    last_search = mallocstrcpy(NULL, word);
-    last_replace = mallocstrcpy(NULL, word);
-
     focusing = TRUE;
 
 #ifndef NANO_TINY
@@ -2394,65 +3021,93 @@ bool do_int_spell_fix(const char *word)
 	    (const filestruct **)&bot, &bot_x, &right_side_up);
 	filepart = partition_filestruct(top, top_x, bot, bot_x);
 
-	/* Foresay whether spell correction will add a magicline. */
-	if (!ISSET(NO_NEWLINES))
-	    added_magicline = (openfile->filebot->data[0] != '\0');
-
 	/* Turn the mark off. */
 	openfile->mark_set = FALSE;
     }
 #endif
 
-    /* Start from the top of the file. */
-    openfile->edittop = openfile->fileage;
-    openfile->current = openfile->fileage;
-    openfile->current_x = (size_t)-1;
-    openfile->placewewant = 0;
+    /* Visit the lines where the word may occur, from the top down. */
+    for (i = 0; i < entry->count && !canceled && !finished; i++) {
+	filestruct *line = entry->lines[i];
+	const char *found;
+	size_t from = 0;
+
+	/* Skip the lines outside of the marked region. */
+	if (line->lineno < openfile->fileage->lineno ||
+		line->lineno > openfile->filebot->lineno)
+	    continue;
 
-    /* Find the first whole occurrence of word. */
-    findnextstr_wrap_reset();
-    while (findnextstr(TRUE, openfile->fileage, 0, word, &match_len)) {
-	if (is_whole_word(openfile->current_x, openfile->current->data,
-		word)) {
-	    size_t xpt = xplustabs();
-	    char *exp_word = display_string(openfile->current->data,
-		xpt, strnlenpt(openfile->current->data,
-		openfile->current_x + match_len) - xpt, FALSE);
+	while ((found = strstr(line->data + from, word)) != NULL) {
+	    int choice;
 
-	    edit_refresh();
+	    openfile->current = line;
+	    openfile->current_x = found - line->data;
+	    from = openfile->current_x + 1;
+
+	    if (!is_whole_word(openfile->current_x, line->data, word))
+		continue;
+
+	    /* At the first occurrence, ask for a replacement. */
+	    if (!prompted) {
+		size_t xpt = xplustabs();
+		char *exp_word = display_line(line, xpt,
+			line_column(line, openfile->current_x +
+			word_len) - xpt, FALSE);
 
-	    do_replace_highlight(TRUE, exp_word);
+		openfile->placewewant = xpt;
 
-	    /* Allow all instances of the word to be corrected. */
-	    canceled = (do_prompt(FALSE,
+		edit_refresh();
+
+		do_replace_highlight(TRUE, exp_word);
+
+		/* Allow all instances of the word to be corrected. */
+		canceled = (do_prompt(FALSE,
 #ifndef DISABLE_TABCOMP
-		TRUE,
+			TRUE,
 #endif
-		MSPELL, word,
+			MSPELL, word,
 #ifndef DISABLE_HISTORIES
-		NULL,
+			NULL,
 #endif
-		edit_refresh, _("Edit a replacement")) == -1);
+			edit_refresh, _("Edit a replacement")) == -1);
+
+		do_replace_highlight(FALSE, exp_word);
+
+		free(exp_word);
 
-	    do_replace_highlight(FALSE, exp_word);
+		prompted = TRUE;
 
-	    free(exp_word);
+		if (canceled || strcmp(word, answer) == 0) {
+		    finished = TRUE;
+		    break;
+		}
+	    }
+
+	    choice = replace_occurrence(word, word_len, &replaceall,
+		numreplaced == 0, &length_change);
 
-	    if (!canceled && strcmp(word, answer) != 0) {
-		openfile->current_x--;
-		do_replace_loop(TRUE, &canceled, openfile->current,
-			&openfile->current_x, word);
+	    if (choice == -1) {
+		canceled = TRUE;
+		break;
 	    }
 
-	    break;
+	    if (choice > 0) {
+		numreplaced++;
+
+		/* The replacement may contain words yet to be checked. */
+		index_spell_text(line, answer, entry - spell_words + 1);
+
+		from = openfile->current_x + strlen(answer);
+	    } else
+		from = openfile->current_x + word_len;
 	}
     }
 
 #ifndef NANO_TINY
     if (old_mark_set) {
-	/* If a magicline was added, remove it again. */
-	if (added_magicline)
-	    remove_magicline();
+	/* The end of the marked text may have shifted with replacements
+	 * on its last line. */
+	bot_x = strlen(openfile->filebot->data);
 
 	/* Put the beginning and the end of the mark at the beginning
 	 * and the end of the spell-checked text. */
@@ -2473,12 +3128,6 @@ bool do_int_spell_fix(const char *word)
     }
 #endif /* !NANO_TINY */
 
-    /* Restore the search/replace strings. */
-    free(last_search);
-    last_search = save_search;
-    free(last_replace);
-    last_replace = save_replace;
-
     /* Restore where we were. */
     openfile->edittop = edittop_save;
     openfile->current = current_save;
@@ -2496,8 +3145,8 @@ bool do_int_spell_fix(const char *word)
  * termination, and the error string otherwise. */
 const char *do_int_speller(const char *tempfile_name)
 {
-    char *read_buff, *read_buff_ptr, *read_buff_word;
-    size_t pipe_buff_size, read_buff_size, read_buff_read, bytesread;
+    char *read_buff, *read_buff_ptr;
+    size_t pipe_buff_size, read_buff_size, read_buff_read, bytesread, i;
     int spell_fd[2], sort_fd[2], uniq_fd[2], tempfile_fd = -1;
     pid_t pid_spell, pid_sort, pid_uniq;
     int spell_status, sort_status, uniq_status;
@@ -2618,27 +3267,15 @@ const char *do_int_speller(const char *tempfile_name)
     *read_buff_ptr = '\0';
     close(uniq_fd[0]);
 
-    /* Process the spelling errors. */
-    read_buff_word = read_buff_ptr = read_buff;
+    /* Index where the misspelled words occur, and process them. */
+    build_spell_index(read_buff);
 
-    while (*read_buff_ptr != '\0') {
-	if ((*read_buff_ptr == '\r') || (*read_buff_ptr == '\n')) {
-	    *read_buff_ptr = '\0';
-	    if (read_buff_word != read_buff_ptr) {
-		if (!do_int_spell_fix(read_buff_word)) {
-		    read_buff_word = read_buff_ptr;
-		    break;
-		}
-	    }
-	    read_buff_word = read_buff_ptr + 1;
-	}
-	read_buff_ptr++;
+    for (i = 0; i < spell_count; i++) {
+	if (!do_int_spell_fix(&spell_words[i]))
+	    break;
     }
 
-    /* Special case: the last word doesn't end with '\r' or '\n'. */
-    if (read_buff_word != read_buff_ptr)
-	do_int_spell_fix(read_buff_word);
-
+    free_spell_index();
     free(read_buff);
     search_replace_abort();
     edit_refresh_needed = TRUE;
@@ -2717,6 +3354,8 @@ const char *do_alt_speller(char *tempfile_name)
 	mb_lineno_save = openfile->mark_begin->lineno;
 	openfile->mark_set = FALSE;
     }
+
+    set_bracketed_paste(FALSE);
 #endif
 
     endwin();
@@ -2755,7 +3394,7 @@ const char *do_alt_speller(char *tempfile_name)
 #endif
 
     /* Wait for the alternate spell checker to finish. */
-    wait(&alt_spell_status);
+    waitpid(pid_spell, &alt_spell_status, 0);
 
     /* Reenter curses mode. */
     doupdate();
@@ -2904,52 +3543,75 @@ void do_spell(void)
 #endif /* !DISABLE_SPELLER */
 
 #ifndef DISABLE_COLOR
-/* Run a linting program on the current buffer.  Return NULL for normal
- * termination, and the error string otherwise. */
-void do_linter(void)
+/* Forget the messages of the last lint run. */
+void free_lints(void)
 {
-    char *read_buff, *read_buff_ptr, *read_buff_word, *ptr;
-    size_t pipe_buff_size, read_buff_size, read_buff_read, bytesread;
-    size_t parsesuccess = 0;
-    int lint_status, lint_fd[2];
-    pid_t pid_lint;
-    static int arglen = 3;
-    static char **lintargs = NULL;
-    char *lintcopy, *convendptr = NULL;
-    lintstruct *lints = NULL, *tmplint = NULL, *curlint = NULL;
+    while (lints != NULL) {
+	lintstruct *tmplint = lints;
 
-    if (ISSET(RESTRICTED)) {
-	show_restricted_warning();
-	return;
+	lints = lints->next;
+	free(tmplint->msg);
+	free(tmplint->filename);
+	free(tmplint);
     }
 
-    if (!openfile->syntax || !openfile->syntax->linter) {
-	statusbar(_("No linter defined for this type of file!"));
-	return;
-    }
+    last_lint = NULL;
+    lint_count = 0;
+}
 
-    if (openfile->modified) {
-	int i = do_yesno_prompt(FALSE, _("Save modified buffer before linting?"));
+/* Stop the linter that is running in the background, if any, and
+ * forget what it reported so far. */
+void cancel_linter(void)
+{
+    if (lint_pid != -1) {
+	kill(lint_pid, SIGKILL);
+	waitpid(lint_pid, NULL, 0);
+	lint_pid = -1;
+    }
 
-	if (i == -1) {
-	    statusbar(_("Cancelled"));
-	    goto exit_from_lint;
-	} else if (i == 1 && (do_writeout(FALSE) != TRUE))
-	    goto exit_from_lint;
+    if (lint_fd != -1) {
+	close(lint_fd);
+	lint_fd = -1;
     }
 
-    lintcopy = mallocstrcpy(NULL, openfile->syntax->linter);
+    free(lint_line);
+    lint_line = NULL;
+    lint_len = 0;
+    lint_size = 0;
+
+    free_lints();
+    lint_buffer = NULL;
+}
+
+/* Cancel the lint run for the given buffer, as it is going away. */
+void forget_linter(const openfilestruct *buffer)
+{
+    if (buffer == lint_buffer)
+	cancel_linter();
+}
+
+/* Start the linter for the current buffer in the background, in place
+ * of any earlier run.  Its output gets handled by handle_lint_output()
+ * as it arrives.  Return TRUE when the linter was started. */
+bool start_linter(void)
+{
+    int lint_pipe[2];
+    pid_t pid_lint;
+    static int arglen = 3;
+    static char **lintargs = NULL;
+    char *lintcopy, *ptr;
+
+    cancel_linter();
+
     /* Create a pipe up front. */
-    if (pipe(lint_fd) == -1) {
+    if (pipe(lint_pipe) == -1) {
 	statusbar(_("Could not create pipe"));
-	goto exit_from_lint;
+	return FALSE;
     }
 
-    blank_bottombars();
-    statusbar(_("Invoking linter, please wait"));
-
     /* Set up an argument list to pass to execvp(). */
     if (lintargs == NULL) {
+	lintcopy = mallocstrcpy(NULL, openfile->syntax->linter);
 	lintargs = (char **)nmalloc(arglen * sizeof(char *));
 
 	lintargs[0] = strtok(lintcopy, " ");
@@ -2964,17 +3626,24 @@ void do_linter(void)
 
     /* Start a new process to run the linter in. */
     if ((pid_lint = fork()) == 0) {
+	int nullfd = open("/dev/null", O_RDONLY);
 
 	/* Child continues here (i.e. the future linting process). */
-	close(lint_fd[0]);
+	close(lint_pipe[0]);
+
+	/* Keep the linter away from the keyboard. */
+	if (nullfd != -1) {
+	    dup2(nullfd, STDIN_FILENO);
+	    close(nullfd);
+	}
 
 	/* Send the linter's standard output + err to the pipe. */
-	if (dup2(lint_fd[1], STDOUT_FILENO) != STDOUT_FILENO)
+	if (dup2(lint_pipe[1], STDOUT_FILENO) != STDOUT_FILENO)
 	    exit(9);
-	if (dup2(lint_fd[1], STDERR_FILENO) != STDERR_FILENO)
+	if (dup2(lint_pipe[1], STDERR_FILENO) != STDERR_FILENO)
 	    exit(9);
 
-	close(lint_fd[1]);
+	close(lint_pipe[1]);
 
 	/* Start the linter program; we are using $PATH. */
 	execvp(lintargs[0], lintargs);
@@ -2984,130 +3653,235 @@ void do_linter(void)
     }
 
     /* Parent continues here. */
-    close(lint_fd[1]);
+    close(lint_pipe[1]);
 
     /* If the child process was not forked successfully... */
     if (pid_lint < 0) {
-	close(lint_fd[0]);
+	close(lint_pipe[0]);
 	statusbar(_("Could not fork"));
-	goto exit_from_lint;
+	return FALSE;
     }
 
-    /* Get the system pipe buffer size. */
-    if ((pipe_buff_size = fpathconf(lint_fd[0], _PC_PIPE_BUF)) < 1) {
-	close(lint_fd[0]);
-	statusbar(_("Could not get size of pipe buffer"));
-	goto exit_from_lint;
+    /* Read the output without blocking, so that typing can go on. */
+    if (fcntl(lint_pipe[0], F_SETFL,
+		fcntl(lint_pipe[0], F_GETFL) | O_NONBLOCK) == -1)
+	nperror("fcntl");
+
+    lint_fd = lint_pipe[0];
+    lint_pid = pid_lint;
+    lint_buffer = openfile;
+    lint_command = mallocstrcpy(lint_command, openfile->syntax->linter);
+
+    return TRUE;
+}
+
+/* Parse one line of output from the linter, and when it contains a
+ * usable line number, add it to the list of messages.  Return TRUE
+ * when it was added. */
+bool parse_lint_line(char *line)
+{
+    char *filename = NULL, *linestr = NULL, *maybecol = NULL;
+    char *message = mallocstrcpy(NULL, line), *convendptr = NULL;
+    ssize_t tmplineno = 0, tmpcolno = 0;
+    lintstruct *newlint;
+
+    /* At the moment we're assuming the following formats:
+     *
+     * filenameorcategory:line:column:message (e.g. splint)
+     * filenameorcategory:line:message        (e.g. pyflakes)
+     * filenameorcategory:line,col:message    (e.g. pylint)
+     *
+     * This could be turned into some scanf() based parser,
+     * but ugh. */
+    if ((filename = strtok(line, ":")) == NULL ||
+		(linestr = strtok(NULL, ":")) == NULL ||
+		(maybecol = strtok(NULL, ":")) == NULL ||
+		(tmplineno = strtol(linestr, NULL, 10)) <= 0) {
+	free(message);
+	return FALSE;
     }
 
-    /* Read in the returned syntax errors. */
-    read_buff_read = 0;
-    read_buff_size = pipe_buff_size + 1;
-    read_buff = read_buff_ptr = charalloc(read_buff_size);
+    tmpcolno = strtol(maybecol, &convendptr, 10);
+    if (*convendptr != '\0') {
+	char *tmplinecol;
+
+	/* Previous field might still be line,col format. */
+	strtok(linestr, ",");
+	if ((tmplinecol = strtok(NULL, ",")) != NULL)
+	    tmpcolno = strtol(tmplinecol, NULL, 10);
+    }
 
-    while ((bytesread = read(lint_fd[0], read_buff_ptr,
-	pipe_buff_size)) > 0) {
 #ifdef DEBUG
-	fprintf(stderr, "text.c:do_linter:%ld bytes (%s)\n", (long)bytesread, read_buff_ptr);
+    fprintf(stderr, "text.c:parse_lint_line:Successful parse! %ld:%ld:%s\n", (long)tmplineno, (long)tmpcolno, message);
 #endif
-	read_buff_read += bytesread;
-	read_buff_size += pipe_buff_size;
-	read_buff = read_buff_ptr = charealloc(read_buff, read_buff_size);
-	read_buff_ptr += read_buff_read;
-    }
+    /* Nice.  We have a lint message we can use. */
+    newlint = (lintstruct *)nmalloc(sizeof(lintstruct));
+    newlint->next = NULL;
+    newlint->prev = last_lint;
+    if (last_lint != NULL)
+	last_lint->next = newlint;
+    else
+	lints = newlint;
+    last_lint = newlint;
 
-    *read_buff_ptr = '\0';
-    close(lint_fd[0]);
+    newlint->msg = message;
+    newlint->lineno = tmplineno;
+    newlint->colno = tmpcolno;
+    newlint->filename = mallocstrcpy(NULL, filename);
 
-#ifdef DEBUG
-		fprintf(stderr, "text.c:do_lint:Raw output: %s\n", read_buff);
-#endif
-
-    /* Process the linter output. */
-    read_buff_word = read_buff_ptr = read_buff;
-
-    while (*read_buff_ptr != '\0') {
-	if ((*read_buff_ptr == '\r') || (*read_buff_ptr == '\n')) {
-	    *read_buff_ptr = '\0';
-	    if (read_buff_word != read_buff_ptr) {
-		char *filename = NULL, *linestr = NULL, *maybecol = NULL;
-		char *message = mallocstrcpy(NULL, read_buff_word);
-
-		/* At the moment we're assuming the following formats:
-		 *
-		 * filenameorcategory:line:column:message (e.g. splint)
-		 * filenameorcategory:line:message        (e.g. pyflakes)
-		 * filenameorcategory:line,col:message    (e.g. pylint)
-		 *
-		 * This could be turned into some scanf() based parser,
-		 * but ugh. */
-		if ((filename = strtok(read_buff_word, ":")) != NULL) {
-		    if ((linestr = strtok(NULL, ":")) != NULL) {
-			if ((maybecol = strtok(NULL, ":")) != NULL) {
-			    ssize_t tmplineno = 0, tmpcolno = 0;
-			    char *tmplinecol;
-
-			    tmplineno = strtol(linestr, NULL, 10);
-			    if (tmplineno <= 0) {
-				read_buff_ptr++;
-				free(message);
-				continue;
-			    }
-
-			    tmpcolno = strtol(maybecol, &convendptr, 10);
-			    if (*convendptr != '\0') {
-				/* Previous field might still be
-				 * line,col format. */
-				strtok(linestr, ",");
-				if ((tmplinecol = strtok(NULL, ",")) != NULL)
-				    tmpcolno = strtol(tmplinecol, NULL, 10);
-			    }
+    lint_count++;
 
-#ifdef DEBUG
-			    fprintf(stderr, "text.c:do_lint:Successful parse! %ld:%ld:%s\n", (long)tmplineno, (long)tmpcolno, message);
-#endif
-			    /* Nice.  We have a lint message we can use. */
-			    parsesuccess++;
-			    tmplint = curlint;
-			    curlint = nmalloc(sizeof(lintstruct));
-			    curlint->next = NULL;
-			    curlint->prev = tmplint;
-			    if (curlint->prev != NULL)
-				curlint->prev->next = curlint;
-			    curlint->msg = mallocstrcpy(NULL, message);
-			    curlint->lineno = tmplineno;
-			    curlint->colno = tmpcolno;
-			    curlint->filename = mallocstrcpy(NULL, filename);
-
-			    if (lints == NULL)
-				lints = curlint;
-			}
-		    }
-		} else
-		    free(message);
+    return TRUE;
+}
+
+/* Read whatever the background linter has written, and collect the
+ * messages from each complete line as it comes in.  Report progress
+ * when in the edit window.  At the end of the output, see whether the
+ * linter has ended, and if so, report the outcome. */
+void handle_lint_output(void)
+{
+    char chunk[BUFSIZ];
+    size_t added = 0;
+	/* The number of new messages. */
+    ssize_t got, i;
+
+    while ((got = read(lint_fd, chunk, sizeof(chunk))) > 0) {
+	for (i = 0; i < got; i++) {
+	    if (chunk[i] == '\r' || chunk[i] == '\n' || chunk[i] == '\0') {
+		if (lint_len > 0) {
+		    lint_line[lint_len] = '\0';
+		    if (parse_lint_line(lint_line))
+			added++;
+		    lint_len = 0;
+		}
+		continue;
 	    }
-	    read_buff_word = read_buff_ptr + 1;
+
+	    if (lint_len + 2 > lint_size) {
+		lint_size = lint_size * 2 + MAX_BUF_SIZE;
+		lint_line = charealloc(lint_line, lint_size);
+	    }
+	    lint_line[lint_len++] = chunk[i];
+	}
+    }
+
+    /* When the output hasn't ended yet, just show how far we are. */
+    if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+		errno == EINTR)) {
+	if (added > 0 && currmenu == MMAIN) {
+	    statusbar(P_("Linting... %lu message so far",
+		"Linting... %lu messages so far", (unsigned long)lint_count),
+		(unsigned long)lint_count);
+	    curs_set(1);
 	}
-	read_buff_ptr++;
+	return;
+    }
+
+    /* Handle a last line that lacks a newline. */
+    if (lint_len > 0) {
+	lint_line[lint_len] = '\0';
+	parse_lint_line(lint_line);
     }
 
-    /* Process the end of the linting process. */
-    waitpid(pid_lint, &lint_status, 0);
+    free(lint_line);
+    lint_line = NULL;
+    lint_len = 0;
+    lint_size = 0;
+
+    close(lint_fd);
+    lint_fd = -1;
+
+    reap_linter();
+}
+
+/* Return TRUE when the linter has closed its output but hasn't ended
+ * yet. */
+bool linter_lingers(void)
+{
+    return (lint_fd == -1 && lint_pid != -1);
+}
+
+/* Collect the exit status of the linter whose output has ended, when
+ * it has ended too, and report the outcome.  A linter that lingers is
+ * looked at again from the main loop. */
+void reap_linter(void)
+{
+    if (!linter_lingers() || waitpid(lint_pid, &lint_status, WNOHANG) == 0)
+	return;
+
+    lint_pid = -1;
+
+    if (currmenu != MMAIN)
+	return;
 
     if (!WIFEXITED(lint_status) || WEXITSTATUS(lint_status) > 2) {
-	statusbar(invocation_error(openfile->syntax->linter));
-	goto exit_from_lint;
+	char *error = invocation_error(lint_command);
+
+	statusbar("%s", error);
+	free(error);
+    } else if (lint_count == 0)
+	statusbar(_("Got 0 parsable lines from command: %s"), lint_command);
+    else
+	statusbar(P_("Linter finished with %lu message",
+		"Linter finished with %lu messages", (unsigned long)lint_count),
+		(unsigned long)lint_count);
+
+    curs_set(1);
+}
+
+/* After the current buffer was saved, drop the lint run for it, which
+ * is now superseded, and start a fresh one when so configured. */
+void lint_after_save(void)
+{
+    if (lint_buffer == openfile)
+	cancel_linter();
+
+    if (ISSET(LINT_ON_SAVE) && !ISSET(RESTRICTED) && openfile->syntax &&
+		openfile->syntax->linter)
+	start_linter();
+}
+
+/* Run a linting program on the current buffer in the background, or,
+ * when it has produced messages for the current buffer, step through
+ * those. */
+void do_linter(void)
+{
+    lintstruct *tmplint = NULL, *curlint = NULL;
+
+    if (ISSET(RESTRICTED)) {
+	show_restricted_warning();
+	return;
     }
 
-    free(read_buff);
+    if (!openfile->syntax || !openfile->syntax->linter) {
+	statusbar(_("No linter defined for this type of file!"));
+	return;
+    }
+
+    if (openfile->modified) {
+	int i = do_yesno_prompt(FALSE, _("Save modified buffer before linting?"));
+
+	if (i == -1) {
+	    statusbar(_("Cancelled"));
+	    goto exit_from_lint;
+	} else if (i == 1 && (do_writeout(FALSE) != TRUE))
+	    goto exit_from_lint;
+    }
+
+    /* Without messages for this buffer, start the linter, and let the
+     * user carry on meanwhile. */
+    if (lint_buffer != openfile || (lint_fd == -1 && lints == NULL)) {
+	if (start_linter())
+	    statusbar(_("Invoking linter in the background"));
+	goto exit_from_lint;
+    }
 
-    if (parsesuccess == 0) {
-	statusbar(_("Got 0 parsable lines from command: %s"), openfile->syntax->linter);
+    if (lints == NULL) {
+	statusbar(_("The linter is still running"));
 	goto exit_from_lint;
     }
 
     bottombars(MLINTER);
-    tmplint = NULL;
     curlint = lints;
 
     while (TRUE) {
@@ -3140,7 +3914,7 @@ void do_linter(void)
 			free(msg);
 			if (i == -1) {
 			    statusbar(_("Cancelled"));
-			    goto free_lints_and_return;
+			    goto exit_from_lint;
 			} else if (i == 1) {
 			    SET(MULTIBUFFER);
 			    open_buffer(curlint->filename, FALSE);
@@ -3200,22 +3974,384 @@ void do_linter(void)
 
     blank_statusbar();
 
-#ifndef NANO_TINY
-  free_lints_and_return:
-#endif
-    for (curlint = lints; curlint != NULL;) {
-	tmplint = curlint;
-	curlint = curlint->next;
-	free(tmplint->msg);
-	free(tmplint->filename);
-	free(tmplint);
-    }
-
   exit_from_lint:
     display_main_list();
 }
 
 #ifndef DISABLE_SPELLER
+#ifndef NANO_TINY
+/* Return a hash of the given line. */
+size_t hash_line(const char *text)
+{
+    size_t hash = 5381;
+
+    while (*text != '\0')
+	hash = hash * 33 + (unsigned char)*text++;
+
+    return hash;
+}
+
+/* Return TRUE when line x of the buffer is the same as line y of the
+ * new text. */
+bool lines_match(const linediff *diff, ssize_t x, ssize_t y)
+{
+    return (diff->old_hashes[x] == diff->new_hashes[y] &&
+	strcmp(diff->old_lines[x]->data, diff->new_lines[y]) == 0);
+}
+
+/* Find the middle of a shortest way to turn the buffer lines xoff up
+ * to xlim into the new lines yoff up to ylim, by searching from both
+ * ends at once, as in the linear-space variant of Myers' algorithm.
+ * Return FALSE when this takes more work than the budget allows. */
+bool find_middle_snake(linediff *diff, ssize_t xoff, ssize_t xlim,
+	ssize_t yoff, ssize_t ylim, ssize_t *xmid, ssize_t *ymid)
+{
+    ssize_t *fd = diff->forward, *bd = diff->backward;
+    ssize_t dmin = xoff - ylim, dmax = xlim - yoff;
+    ssize_t fmid = xoff - yoff, bmid = xlim - ylim;
+    ssize_t fmin = fmid, fmax = fmid, bmin = bmid, bmax = bmid;
+    bool odd = ((fmid - bmid) & 1) != 0;
+    ssize_t d;
+
+    fd[fmid] = xoff;
+    bd[bmid] = xlim;
+
+    while (TRUE) {
+	size_t cost = fmax - fmin + bmax - bmin + 2;
+
+	if (diff->budget < cost)
+	    return FALSE;
+	diff->budget -= cost;
+
+	/* Extend each forward path by one more edit, and then along
+	 * the lines that match. */
+	if (fmin > dmin)
+	    fd[--fmin - 1] = -1;
+	else
+	    fmin++;
+	if (fmax < dmax)
+	    fd[++fmax + 1] = -1;
+	else
+	    fmax--;
+
+	for (d = fmax; d >= fmin; d -= 2) {
+	    ssize_t x, y, tlo = fd[d - 1], thi = fd[d + 1];
+
+	    x = (tlo >= thi) ? tlo + 1 : thi;
+	    y = x - d;
+	    while (x < xlim && y < ylim && lines_match(diff, x, y)) {
+		x++;
+		y++;
+	    }
+	    fd[d] = x;
+
+	    if (odd && bmin <= d && d <= bmax && bd[d] <= x) {
+		*xmid = x;
+		*ymid = y;
+		return TRUE;
+	    }
+	}
+
+	/* Do the same for the backward paths. */
+	if (bmin > dmin)
+	    bd[--bmin - 1] = xlim + 1;
+	else
+	    bmin++;
+	if (bmax < dmax)
+	    bd[++bmax + 1] = xlim + 1;
+	else
+	    bmax--;
+
+	for (d = bmax; d >= bmin; d -= 2) {
+	    ssize_t x, y, tlo = bd[d - 1], thi = bd[d + 1];
+
+	    x = (tlo < thi) ? tlo : thi - 1;
+	    y = x - d;
+	    while (x > xoff && y > yoff && lines_match(diff, x - 1, y - 1)) {
+		x--;
+		y--;
+	    }
+	    bd[d] = x;
+
+	    if (!odd && fmin <= d && d <= fmax && x <= fd[d]) {
+		*xmid = x;
+		*ymid = y;
+		return TRUE;
+	    }
+	}
+    }
+}
+
+/* Mark which of the buffer lines xoff up to xlim and of the new lines
+ * yoff up to ylim are not part of a longest common subsequence. */
+void compare_lines(linediff *diff, ssize_t xoff, ssize_t xlim,
+	ssize_t yoff, ssize_t ylim)
+{
+    ssize_t xmid, ymid;
+
+    /* Skip the lines that are the same at both ends. */
+    while (xoff < xlim && yoff < ylim && lines_match(diff, xoff, yoff)) {
+	xoff++;
+	yoff++;
+    }
+    while (xoff < xlim && yoff < ylim &&
+		lines_match(diff, xlim - 1, ylim - 1)) {
+	xlim--;
+	ylim--;
+    }
+
+    if (xoff < xlim && yoff < ylim &&
+		find_middle_snake(diff, xoff, xlim, yoff, ylim, &xmid, &ymid)) {
+	compare_lines(diff, xoff, xmid, yoff, ymid);
+	compare_lines(diff, xmid, xlim, ymid, ylim);
+	return;
+    }
+
+    /* Either one side is exhausted, or finding the smallest difference
+     * is too costly: consider all remaining lines as changed. */
+    while (xoff < xlim)
+	diff->old_changed[xoff++] = TRUE;
+    while (yoff < ylim)
+	diff->new_changed[yoff++] = TRUE;
+}
+
+/* Split the given text of size bytes into lines, in place, the way
+ * read_file() would.  The text must have room for one more byte.
+ * Return the lines, and store their number in count. */
+char **split_lines(char *text, size_t size, size_t *count)
+{
+    size_t slots = 64, i;
+    char **lines = (char **)nmalloc(slots * sizeof(char *));
+    char *start = text;
+
+    *count = 0;
+
+    for (i = 0; i <= size; i++) {
+	if (i < size) {
+	    if (text[i] == '\0') {
+		/* Nulls are stored as newlines. */
+		text[i] = '\n';
+		continue;
+	    } else if (text[i] == '\r' && !ISSET(NO_CONVERT)) {
+		/* Both a DOS and a Mac line ending end a line. */
+		if (i + 1 < size && text[i + 1] == '\n')
+		    text[i++] = '\0';
+	    } else if (text[i] != '\n')
+		continue;
+	}
+
+	text[i] = '\0';
+
+	if (*count + 2 > slots) {
+	    slots *= 2;
+	    lines = (char **)nrealloc(lines, slots * sizeof(char *));
+	}
+	lines[(*count)++] = start;
+	start = text + i + 1;
+    }
+
+    /* Like read_file(), add a magicline when needed. */
+    if (!ISSET(NO_NEWLINES) && lines[*count - 1][0] != '\0')
+	lines[(*count)++] = (char *)"";
+
+    return lines;
+}
+
+/* Replace the buffer lines s up to e (out of count) with the new lines
+ * t up to u, through an undoable cut and paste. */
+void replace_lines(linediff *diff, size_t count, size_t s, size_t e,
+	size_t t, size_t u)
+{
+    filestruct *top, *bot, *chunk = NULL, *bottom = NULL;
+    size_t top_x = 0, bot_x = 0, i;
+    bool trailing = (e < count), leading = (!trailing && s > 0);
+	/* Whether the replaced lines end with or start with a newline. */
+
+    if (trailing) {
+	top = diff->old_lines[s];
+	bot = diff->old_lines[e];
+    } else {
+	top = diff->old_lines[leading ? s - 1 : 0];
+	top_x = leading ? strlen(top->data) : 0;
+	bot = diff->old_lines[count - 1];
+	bot_x = strlen(bot->data);
+    }
+
+    openfile->current = bot;
+    openfile->current_x = bot_x;
+
+    if (top != bot || top_x != bot_x) {
+	openfile->mark_set = TRUE;
+	openfile->mark_begin = top;
+	openfile->mark_begin_x = top_x;
+
+	do_cut_text_void();
+
+	free_filestruct(cutbuffer);
+	cutbuffer = NULL;
+	cutbottom = NULL;
+    }
+
+    /* Gather the new lines, with the newline in the right place. */
+    for (i = (leading ? t - 1 : t); i < u + (trailing ? 1 : 0); i++) {
+	filestruct *newnode = make_new_node(bottom);
+
+	newnode->data = mallocstrcpy(NULL, (i < t || i == u) ? "" :
+		diff->new_lines[i]);
+	if (bottom == NULL)
+	    chunk = newnode;
+	else
+	    bottom->next = newnode;
+	bottom = newnode;
+    }
+
+    if (chunk != NULL && (chunk != bottom || chunk->data[0] != '\0')) {
+	cutbuffer = chunk;
+	cutbottom = bottom;
+
+	do_uncut_text();
+
+	cutbuffer = NULL;
+	cutbottom = NULL;
+    }
+
+    free_filestruct(chunk);
+
+    /* The line in front of the replacement has been renewed, so point
+     * to its new incarnation, in case a change above ends there. */
+    if (leading) {
+	filestruct *line = openfile->current;
+
+	for (i = t; i < u; i++)
+	    line = line->prev;
+	diff->old_lines[s - 1] = line;
+    }
+}
+
+/* Turn the text of the current buffer into the text of the given file,
+ * changing only the lines that differ, as a single undoable action.
+ * Return TRUE when anything changed. */
+bool apply_formatted_text(const char *filename)
+{
+    linediff diff;
+    filestruct *line, *oldcutbuffer = cutbuffer, *oldcutbottom = cutbottom;
+    size_t old_count = 0, new_count, size = 0, i, j;
+    struct stat fileinfo;
+    bool changed = FALSE;
+    char *text;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+
+    if (fd == -1)
+	return FALSE;
+
+    if (fstat(fd, &fileinfo) == -1) {
+	close(fd);
+	return FALSE;
+    }
+
+    text = charalloc(fileinfo.st_size + 1);
+
+    while (size < (size_t)fileinfo.st_size) {
+	ssize_t got = read(fd, text + size, fileinfo.st_size - size);
+
+	if (got > 0)
+	    size += got;
+	else if (got == 0 || errno != EINTR)
+	    break;
+    }
+
+    close(fd);
+
+    /* When the file couldn't be read completely, leave the buffer as
+     * it is, instead of cutting away what is missing. */
+    if (size != (size_t)fileinfo.st_size) {
+	free(text);
+	return FALSE;
+    }
+
+    for (line = openfile->fileage; line != NULL; line = line->next)
+	old_count++;
+
+    diff.old_lines = (filestruct **)nmalloc(old_count * sizeof(filestruct *));
+    diff.old_hashes = (size_t *)nmalloc(old_count * sizeof(size_t));
+    diff.old_changed = (bool *)nmalloc(old_count * sizeof(bool));
+
+    for (i = 0, line = openfile->fileage; line != NULL; i++, line = line->next) {
+	diff.old_lines[i] = line;
+	diff.old_hashes[i] = hash_line(line->data);
+	diff.old_changed[i] = FALSE;
+    }
+
+    diff.new_lines = split_lines(text, size, &new_count);
+    diff.new_hashes = (size_t *)nmalloc(new_count * sizeof(size_t));
+    diff.new_changed = (bool *)nmalloc(new_count * sizeof(bool));
+
+    for (j = 0; j < new_count; j++) {
+	diff.new_hashes[j] = hash_line(diff.new_lines[j]);
+	diff.new_changed[j] = FALSE;
+    }
+
+    /* The paths run over diagonals -new_count - 1 up to old_count + 1. */
+    diff.forward = (ssize_t *)nmalloc((old_count + new_count + 3) *
+	sizeof(ssize_t)) + new_count + 1;
+    diff.backward = (ssize_t *)nmalloc((old_count + new_count + 3) *
+	sizeof(ssize_t)) + new_count + 1;
+    diff.budget = 1000000 + 64 * (old_count + new_count);
+
+    compare_lines(&diff, 0, old_count, 0, new_count);
+
+    cutbuffer = NULL;
+    cutbottom = NULL;
+
+    /* Replace each run of changed lines, starting at the bottom, so
+     * that the positions of the runs above remain valid. */
+    i = old_count;
+    j = new_count;
+
+    while (i > 0 || j > 0) {
+	size_t old_end = i, new_end = j;
+
+	while (i > 0 && diff.old_changed[i - 1])
+	    i--;
+	while (j > 0 && diff.new_changed[j - 1])
+	    j--;
+
+	if (i == old_end && j == new_end) {
+	    i--;
+	    j--;
+	    continue;
+	}
+
+	if (!changed)
+	    add_undo(FILTER_BEGIN);
+	changed = TRUE;
+
+	replace_lines(&diff, old_count, i, old_end, j, new_end);
+    }
+
+    if (changed)
+	add_undo(FILTER_END);
+
+    cutbuffer = oldcutbuffer;
+    cutbottom = oldcutbottom;
+    cutbuffer_reset();
+
+    free(diff.old_lines);
+    free(diff.old_hashes);
+    free(diff.old_changed);
+    free(diff.new_lines);
+    free(diff.new_hashes);
+    free(diff.new_changed);
+    free(diff.forward - new_count - 1);
+    free(diff.backward - new_count - 1);
+    free(text);
+
+    return changed;
+}
+#endif /* !NANO_TINY */
+
 /* Run a formatter for the current syntax.  This expects the formatter
  * to be non-interactive and operate on a file in-place, which we'll
  * pass it on the command line. */
@@ -3295,21 +4431,30 @@ void do_formatter(void)
 #endif
 
     /* Wait for the formatter to finish. */
-    wait(&format_status);
+    waitpid(pid_format, &format_status, 0);
 
     if (!WIFEXITED(format_status) || WEXITSTATUS(format_status) != 0)
 	finalstatus = invocation_error(openfile->syntax->formatter);
     else {
+#ifndef NANO_TINY
+	/* Change just those lines of the buffer that were formatted
+	 * differently, so that the rest keeps its highlighting state,
+	 * and the whole can be undone in one go. */
+	apply_formatted_text(temp);
+#else
 	/* Replace the text of the current buffer with the formatted text. */
 	replace_buffer(temp);
+#endif
 
-	/* Restore the cursor position, and mark the file as modified. */
+	/* Restore the cursor position. */
 	goto_line_posx(lineno_save, current_x_save);
 	openfile->current_y = current_y_save;
 	openfile->placewewant = pww_save;
 	edit_update(NONE);
 
+#ifdef NANO_TINY
 	set_modified();
+#endif
 
 	finalstatus = _("Finished formatting");
     }
@@ -3335,15 +4480,121 @@ void do_formatter(void)
 #endif /* !DISABLE_COLOR */
 
 #ifndef NANO_TINY
+/* Count the words and the characters in the range of lines that tally
+ * describes.  A word begins at every word character (an alphanumeric
+ * or punctuation character, as "wc -w" has it) that starts a line or
+ * follows a non-word character, which is exactly where the repeated
+ * do_next_word(TRUE, FALSE) calls of old used to stop.  As words never
+ * span lines, ranges of lines can be counted independently. */
+void *tally_lines(void *data)
+{
+    tallystruct *tally = (tallystruct *)data;
+    const filestruct *line = tally->first;
+    size_t n;
+
+    for (n = 0; n < tally->lines; n++, line = line->next) {
+	const char *text = line->data;
+	bool in_word = FALSE;
+
+	while (*text != '\0') {
+	    bool is_word = is_word_mbchar(text, TRUE);
+
+	    if (is_word && !in_word)
+		tally->words++;
+	    in_word = is_word;
+
+	    text += parse_mbchar(text, NULL, NULL);
+	    tally->chars++;
+	}
+
+	/* Count the newline if we have one. */
+	if (line->next != NULL)
+	    tally->chars++;
+    }
+
+    return NULL;
+}
+
+/* Count the words and the characters in the current buffer (or the
+ * partition of it).  When it has many lines, split them into ranges
+ * that are counted in parallel, and add up the results. */
+void tally_buffer(size_t *words, size_t *chars)
+{
+    size_t lines = openfile->filebot->lineno -
+	openfile->fileage->lineno + 1;
+    size_t ranges = 1, i;
+    const filestruct *line = openfile->fileage;
+    tallystruct *tally;
+#ifdef USE_THREADS
+    pthread_t *threads;
+    bool *started;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cpus > 1 && lines >= 2 * TALLY_LINES) {
+	ranges = lines / TALLY_LINES;
+	if (ranges > cpus)
+	    ranges = cpus;
+	if (ranges > MAX_TALLY_THREADS)
+	    ranges = MAX_TALLY_THREADS;
+    }
+#endif
+
+    tally = (tallystruct *)nmalloc(ranges * sizeof(tallystruct));
+
+    /* Divide the lines evenly over the ranges. */
+    for (i = 0; i < ranges; i++) {
+	size_t n;
+
+	tally[i].first = line;
+	tally[i].lines = lines / ranges + (i < lines % ranges ? 1 : 0);
+	tally[i].words = 0;
+	tally[i].chars = 0;
+
+	if (i + 1 < ranges)
+	    for (n = 0; n < tally[i].lines; n++)
+		line = line->next;
+    }
+
+#ifdef USE_THREADS
+    threads = (pthread_t *)nmalloc(ranges * sizeof(pthread_t));
+    started = (bool *)nmalloc(ranges * sizeof(bool));
+
+    /* Count all ranges but the first one in threads of their own, and
+     * any range whose thread could not be started right here. */
+    for (i = 1; i < ranges; i++)
+	started[i] = (pthread_create(&threads[i], NULL, tally_lines,
+		&tally[i]) == 0);
+#endif
+
+    tally_lines(&tally[0]);
+
+    *words = tally[0].words;
+    *chars = tally[0].chars;
+
+    for (i = 1; i < ranges; i++) {
+#ifdef USE_THREADS
+	if (started[i])
+	    pthread_join(threads[i], NULL);
+	else
+	    tally_lines(&tally[i]);
+#endif
+	*words += tally[i].words;
+	*chars += tally[i].chars;
+    }
+
+#ifdef USE_THREADS
+    free(threads);
+    free(started);
+#endif
+    free(tally);
+}
+
 /* Our own version of "wc".  Note that its character counts are in
  * multibyte characters instead of single-byte characters. */
 void do_wordlinechar_count(void)
 {
     size_t words = 0, chars = 0;
     ssize_t nlines = 0;
-    size_t current_x_save = openfile->current_x;
-    size_t pww_save = openfile->placewewant;
-    filestruct *current_save = openfile->current;
     bool old_mark_set = openfile->mark_set;
     filestruct *top, *bot;
     size_t top_x, bot_x;
@@ -3357,26 +4608,14 @@ void do_wordlinechar_count(void)
 	openfile->mark_set = FALSE;
     }
 
-    /* Start at the top of the file. */
-    openfile->current = openfile->fileage;
-    openfile->current_x = 0;
-    openfile->placewewant = 0;
+    /* Count the words (counting punctuation characters as part of a
+     * word, as "wc -w" does), and the characters in multibyte
+     * characters, as "wc -m" does. */
+    tally_buffer(&words, &chars);
 
-    /* Keep moving to the next word (counting punctuation characters as
-     * part of a word, as "wc -w" does), without updating the screen,
-     * until we reach the end of the file, incrementing the total word
-     * count whenever we're on a word just before moving. */
-    while (openfile->current != openfile->filebot ||
-	openfile->current->data[openfile->current_x] != '\0') {
-	if (do_next_word(TRUE, FALSE))
-	    words++;
-    }
-
-    /* Get the total line and character counts, as "wc -l"  and "wc -c"
-     * do, but get the latter in multibyte characters. */
+    /* Get the total line count, as "wc -l" does. */
     if (old_mark_set) {
 	nlines = openfile->filebot->lineno - openfile->fileage->lineno + 1;
-	chars = get_totsize(openfile->fileage, openfile->filebot);
 
 	/* Unpartition the filestruct so that it contains all the text
 	 * again, and turn the mark back on. */
@@ -3387,11 +4626,6 @@ void do_wordlinechar_count(void)
 	chars = openfile->totsize;
     }
 
-    /* Restore where we were. */
-    openfile->current = current_save;
-    openfile->current_x = current_x_save;
-    openfile->placewewant = pww_save;
-
     /* Display the total word, line, and character counts on the statusbar. */
     statusbar(_("%sWords: %lu  Lines: %ld  Chars: %lu"), old_mark_set ?
 	_("In Selection:  ") : "", (unsigned long)words, (long)nlines,
@@ -457,7 +457,7 @@ size_t get_page_start(size_t column)
 size_t xplustabs(void)
 {
     if (openfile->current)
-	return strnlenpt(openfile->current->data, openfile->current_x);
+	return line_column(openfile->current, openfile->current_x);
     else
 	return 0;
 }
@@ -521,6 +521,321 @@ size_t strlenpt(const char *s)
     return strnlenpt(s, (size_t)-1);
 }
 
+#ifndef NANO_TINY
+/* Return the column at which the given chunk ends. */
+static size_t chunk_end(const chunkinfo *chunk)
+{
+    size_t column = chunk->column + chunk->lead;
+
+    if (chunk->hastab)
+	column += tabsize - column % tabsize + chunk->tail;
+
+    return column;
+}
+
+/* Measure the characters of data from start onward into chunk, and stop
+ * at the first character boundary at or after end.  Return where that
+ * boundary is. */
+static size_t measure_chunk(const char *data, size_t start, size_t end,
+	chunkinfo *chunk)
+{
+    chunk->start = start;
+    chunk->lead = 0;
+    chunk->tail = 0;
+    chunk->hastab = FALSE;
+
+    /* How wide the first tab is depends on where the chunk begins, but
+     * after it everything falls the same way relative to a tab stop. */
+    while (start < end && data[start] != '\t')
+	start += parse_mbchar(data + start, NULL, &chunk->lead);
+
+    if (start < end) {
+	chunk->hastab = TRUE;
+	start++;
+    }
+
+    while (start < end)
+	start += parse_mbchar(data + start, NULL, &chunk->tail);
+
+    return start;
+}
+
+/* Replace the chunks first up to last of the given index by new ones that
+ * cover the text of data from start up to end, where end is the start of
+ * chunk last, or the end of the line.  When a character turns out to
+ * straddle end, the chunks it reaches into get taken in too. */
+static void rechunk(linechunks *index, const char *data, size_t first,
+	size_t last, size_t start, size_t end)
+{
+    chunkinfo *fresh = NULL;
+    size_t count = 0, size = 0, pos = start, i;
+
+    while (TRUE) {
+	/* Cut the stretch into pieces of roughly equal size, so that
+	 * edits don't leave a trail of tiny chunks behind. */
+	size_t pieces = (end - pos + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	size_t piece = (pieces > 0) ? (end - pos) / pieces + 1 : 0;
+
+	while (pos < end) {
+	    if (count == size) {
+		size = size * 2 + 4;
+		fresh = (chunkinfo *)nrealloc(fresh, size * sizeof(chunkinfo));
+	    }
+	    pos = measure_chunk(data, pos, MIN(pos + piece, end),
+		&fresh[count++]);
+	}
+
+	if (pos == end)
+	    break;
+
+	while (last < index->count && index->chunk[last].start < pos)
+	    last++;
+	end = (last < index->count) ? index->chunk[last].start : index->len;
+
+	if (pos == end)
+	    break;
+    }
+
+    if (index->count - (last - first) + count > index->size) {
+	index->size = index->count - (last - first) + count + 16;
+	index->chunk = (chunkinfo *)nrealloc(index->chunk,
+		index->size * sizeof(chunkinfo));
+    }
+
+    memmove(index->chunk + first + count, index->chunk + last,
+	(index->count - last) * sizeof(chunkinfo));
+    if (count > 0)
+	memcpy(index->chunk + first, fresh, count * sizeof(chunkinfo));
+    index->count = index->count - (last - first) + count;
+    free(fresh);
+
+    /* The chunks from first onward may now begin at other columns. */
+    for (i = first; i < index->count; i++)
+	index->chunk[i].column = (i == 0) ? 0 :
+		chunk_end(&index->chunk[i - 1]);
+}
+
+/* Free the given index of chunks. */
+void free_chunks(linechunks *index)
+{
+    if (index != NULL) {
+	free(index->chunk);
+	free(index);
+    }
+}
+
+/* Return whether the index of chunks of the given line, if it has one,
+ * still describes its text. */
+bool chunks_current(const filestruct *line)
+{
+    return (line->chunks != NULL && line->chunks->data == line->data &&
+		line->chunks->stamp == edit_stamp);
+}
+
+/* Return the index of chunks of the given line, making it anew when the
+ * text has changed since, or NULL when the line is too short to need
+ * one. */
+linechunks *line_chunks(filestruct *line)
+{
+    linechunks *index = line->chunks;
+    size_t len;
+
+    if (chunks_current(line))
+	return index;
+
+    len = strlen(line->data);
+
+    if (len < CHUNKED_LENGTH) {
+	free_chunks(index);
+	line->chunks = NULL;
+	return NULL;
+    }
+
+    if (index == NULL) {
+	index = (linechunks *)nmalloc(sizeof(linechunks));
+	index->size = 0;
+	index->chunk = NULL;
+	line->chunks = index;
+    }
+
+    index->data = line->data;
+    index->stamp = edit_stamp;
+    index->len = len;
+    index->count = 0;
+
+    rechunk(index, line->data, 0, 0, 0, len);
+
+    return index;
+}
+
+/* Bring the index of chunks of the given line up to date after removed
+ * bytes at position x were replaced by added ones, provided the index
+ * was current at the given stamp just before the change.  When it has
+ * been made anew in the meantime, or wasn't current, leave it be. */
+void update_chunks(filestruct *line, size_t stamp, size_t x,
+	size_t removed, size_t added)
+{
+    linechunks *index = line->chunks;
+    size_t first = 0, last, i;
+
+    if (index == NULL || index->stamp != stamp)
+	return;
+
+    assert(x + removed <= index->len);
+
+    index->len = index->len - removed + added;
+
+    /* A line that has shrunk well below the threshold can do without. */
+    if (index->len < CHUNKED_LENGTH / 2) {
+	free_chunks(index);
+	line->chunks = NULL;
+	return;
+    }
+
+    /* Find the chunk holding x, and include the one before it, as the
+     * character there may have been cut off or completed. */
+    while (first + 1 < index->count && index->chunk[first + 1].start <= x)
+	first++;
+    if (first > 0)
+	first--;
+
+    /* Find the chunks beyond the change, and shift them. */
+    for (last = first + 1; last < index->count &&
+		index->chunk[last].start <= x + removed; last++)
+	;
+    for (i = last; i < index->count; i++)
+	index->chunk[i].start = index->chunk[i].start - removed + added;
+
+    rechunk(index, line->data, first, last,
+	(index->count > 0) ? index->chunk[first].start : 0,
+	(last < index->count) ? index->chunk[last].start : index->len);
+
+    index->data = line->data;
+    index->stamp = edit_stamp;
+}
+#endif /* !NANO_TINY */
+
+/* Return the length of the given line, like strlen() does, but take it
+ * from the index when the line is a long one. */
+size_t line_length(filestruct *line)
+{
+#ifndef NANO_TINY
+    if (chunks_current(line))
+	return line->chunks->len;
+#endif
+
+    return strlen(line->data);
+}
+
+/* Return the column of position x in the given line, like strnlenpt()
+ * does, but with a long line look only at the chunk that holds x. */
+size_t line_column(filestruct *line, size_t x)
+{
+#ifndef NANO_TINY
+    linechunks *index = line_chunks(line);
+
+    if (index != NULL && x > 0) {
+	size_t low = 0, high = index->count, column;
+	const char *s;
+
+	/* Find the last chunk that begins before x. */
+	while (high - low > 1) {
+	    size_t middle = (low + high) / 2;
+
+	    if (index->chunk[middle].start < x)
+		low = middle;
+	    else
+		high = middle;
+	}
+
+	column = index->chunk[low].column;
+	s = line->data + index->chunk[low].start;
+	x -= index->chunk[low].start;
+
+	while (*s != '\0') {
+	    int s_len = parse_mbchar(s, NULL, &column);
+
+	    s += s_len;
+
+	    if (x <= s_len)
+		break;
+
+	    x -= s_len;
+	}
+
+	return column;
+    }
+#endif
+
+    return strnlenpt(line->data, x);
+}
+
+/* Return the index in the given line of the character displayed at the
+ * given column, like actual_x() does, but with a long line look only at
+ * the chunk that holds the column. */
+size_t line_actual_x(filestruct *line, size_t column)
+{
+#ifndef NANO_TINY
+    linechunks *index = line_chunks(line);
+
+    if (index != NULL) {
+	size_t low = 0, high = index->count, i, len;
+
+	/* Find the first chunk that ends beyond column. */
+	while (low < high) {
+	    size_t middle = (low + high) / 2;
+
+	    if (chunk_end(&index->chunk[middle]) > column)
+		high = middle;
+	    else
+		low = middle + 1;
+	}
+
+	if (low == index->count)
+	    return index->len;
+
+	i = index->chunk[low].start;
+	len = index->chunk[low].column;
+
+	while (line->data[i] != '\0') {
+	    int s_len = parse_mbchar(line->data + i, NULL, &len);
+
+	    if (len > column)
+		break;
+
+	    i += s_len;
+	}
+
+	return i;
+    }
+#endif
+
+    return actual_x(line->data, column);
+}
+
+/* Return the display width of the given line, like strlenpt() does, but
+ * measure the line only when its text may have changed since the last
+ * time, which is known the same way as for the index of chunks. */
+size_t line_width(filestruct *line)
+{
+#ifndef NANO_TINY
+    /* A long line whose index is current knows its width already. */
+    if (chunks_current(line))
+	return chunk_end(&line->chunks->chunk[line->chunks->count - 1]);
+
+    if (line->width == (size_t)-1 || line->width_data != line->data ||
+		line->width_stamp != edit_stamp) {
+	line->width = strlenpt(line->data);
+	line->width_data = line->data;
+	line->width_stamp = edit_stamp;
+    }
+
+    return line->width;
+#else
+    return strlenpt(line->data);
+#endif
+}
+
 /* Append a new magicline to filebot. */
 void new_magicline(void)
 {
@@ -531,6 +846,10 @@ void new_magicline(void)
     openfile->filebot->next->lineno = openfile->filebot->lineno + 1;
 #ifndef DISABLE_COLOR
     openfile->filebot->next->multidata = NULL;
+#endif
+#ifndef NANO_TINY
+    openfile->filebot->next->width = (size_t)-1;
+    openfile->filebot->next->chunks = NULL;
 #endif
     openfile->filebot = openfile->filebot->next;
     openfile->totsize++;
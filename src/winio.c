@@ -28,12 +28,24 @@
 #include <string.h>
 #include <unistd.h>
 #include <ctype.h>
+#ifdef DEBUG
+#include <sys/time.h>
+#endif
 
 static int *key_buffer = NULL;
 	/* The keystroke buffer, containing all the keystrokes we
-	 * haven't handled yet at a given point. */
+	 * haven't handled yet at a given point.  It is a ring: the
+	 * keystrokes start at key_buffer_head and wrap around its end. */
+static size_t key_buffer_size = 0;
+	/* The capacity of the keystroke buffer; always a power of two. */
+static size_t key_buffer_head = 0;
+	/* The position of the first pending keystroke in the buffer. */
 static size_t key_buffer_len = 0;
-	/* The length of the keystroke buffer. */
+	/* The number of pending keystrokes in the buffer. */
+#ifdef DEBUG
+static struct timeval key_arrival;
+	/* When the first keystroke of the last batch was read in. */
+#endif
 static int statusblank = 0;
 	/* The number of keystrokes left after we call statusbar(),
 	 * before we actually blank the statusbar. */
@@ -106,6 +118,47 @@ static sig_atomic_t sigwinch_counter_save = 0;
  * - F16 on FreeBSD console == Shift-Down on rxvt/Eterm; the former is
  *   omitted.  (Same as above.) */
 
+/* Make sure the keystroke buffer can hold at least needed keystrokes,
+ * moving the pending ones to its start when it has to be enlarged. */
+void reserve_key_buffer(size_t needed)
+{
+    size_t new_size = (key_buffer_size == 0) ? KEY_BUFFER_SIZE :
+		key_buffer_size;
+    int *new_buffer;
+
+    if (needed <= key_buffer_size)
+	return;
+
+    while (new_size < needed)
+	new_size *= 2;
+
+    new_buffer = (int *)nmalloc(new_size * sizeof(int));
+
+    if (key_buffer_len > 0) {
+	size_t first = key_buffer_size - key_buffer_head;
+
+	if (first > key_buffer_len)
+	    first = key_buffer_len;
+
+	memcpy(new_buffer, key_buffer + key_buffer_head,
+		first * sizeof(int));
+	memcpy(new_buffer + first, key_buffer, (key_buffer_len - first) *
+		sizeof(int));
+    }
+
+    free(key_buffer);
+    key_buffer = new_buffer;
+    key_buffer_size = new_size;
+    key_buffer_head = 0;
+}
+
+/* Return the keystroke at the given offset from the start of the
+ * keystroke buffer, which must be within its length. */
+int peek_key_buffer(size_t index)
+{
+    return key_buffer[(key_buffer_head + index) & (key_buffer_size - 1)];
+}
+
 /* Read in a sequence of keystrokes from win and save them in the
  * keystroke buffer.  This should only be called when the keystroke
  * buffer is empty. */
@@ -115,20 +168,38 @@ void get_key_buffer(WINDOW *win)
     size_t errcount;
 
     /* If the keystroke buffer isn't empty, get out. */
-    if (key_buffer != NULL)
+    if (key_buffer_len > 0)
 	return;
 
     /* Just before reading in the first character, display any pending
      * screen updates. */
     doupdate();
 
+#ifdef DEBUG
+    /* Report how long it took from reading in the previous batch of
+     * keystrokes to getting the result of handling them on screen. */
+    if (key_arrival.tv_sec != 0) {
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	fprintf(stderr, "\nget_key_buffer(): %ld microseconds from "
+		"keystroke to screen update\n",
+		(long)(now.tv_sec - key_arrival.tv_sec) * 1000000 +
+		(long)(now.tv_usec - key_arrival.tv_usec));
+	key_arrival.tv_sec = 0;
+    }
+#endif
+
     /* Read in the first character using whatever mode we're in. */
     errcount = 0;
     if (nodelay_mode) {
 	if ((input = wgetch(win)) == ERR)
 	    return;
     } else {
-	while ((input = wgetch(win)) == ERR) {
+	/* While stdin or a followed file is being read, wait for a
+	 * keystroke without blocking in curses, so as to handle what
+	 * arrives meanwhile. */
+	while (!wait_for_keystroke() || (input = wgetch(win)) == ERR) {
 #ifndef NANO_TINY
 	    /* Did we get SIGWINCH since we were last here? */
 	    if (sigwinch_counter != sigwinch_counter_save) {
@@ -150,11 +221,14 @@ void get_key_buffer(WINDOW *win)
 	}
     }
 
-    /* Increment the length of the keystroke buffer, and save the value
-     * of the keystroke at the end of it. */
-    key_buffer_len++;
-    key_buffer = (int *)nmalloc(sizeof(int));
-    key_buffer[0] = input;
+#ifdef DEBUG
+    gettimeofday(&key_arrival, NULL);
+#endif
+
+    /* The buffer is empty, so start filling it from its beginning. */
+    reserve_key_buffer(KEY_BUFFER_SIZE);
+    key_buffer_head = 0;
+    key_buffer[key_buffer_len++] = input;
 
 #ifndef NANO_TINY
     /* If we got SIGWINCH, get out immediately since the win argument is
@@ -163,22 +237,19 @@ void get_key_buffer(WINDOW *win)
 	return;
 #endif
 
-    /* Read in the remaining characters using non-blocking input. */
+    /* Read in the remaining characters using non-blocking input, until
+     * there are no more or the buffer is full.  Whatever doesn't fit
+     * stays queued in curses, to be read in on the next call. */
     nodelay(win, TRUE);
 
-    while (TRUE) {
+    while (key_buffer_len < key_buffer_size) {
 	input = wgetch(win);
 
 	/* If there aren't any more characters, stop reading. */
 	if (input == ERR)
 	    break;
 
-	/* Otherwise, increment the length of the keystroke buffer, and
-	 * save the value of the keystroke at the end of it. */
-	key_buffer_len++;
-	key_buffer = (int *)nrealloc(key_buffer, key_buffer_len *
-		sizeof(int));
-	key_buffer[key_buffer_len - 1] = input;
+	key_buffer[key_buffer_len++] = input;
     }
 
     /* Switch back to waiting mode for input. */
@@ -201,9 +272,11 @@ size_t get_key_buffer_len(void)
     return key_buffer_len;
 }
 
-/* Add the keystrokes in input to the keystroke buffer. */
+/* Add the keystrokes in input to the start of the keystroke buffer. */
 void unget_input(int *input, size_t input_len)
 {
+    size_t i;
+
     /* If input is empty, get out. */
     if (input_len == 0)
 	return;
@@ -214,21 +287,14 @@ void unget_input(int *input, size_t input_len)
     if (key_buffer_len + input_len < key_buffer_len)
 	input_len = (size_t)-1 - key_buffer_len;
 
-    /* Add the length of input to the length of the keystroke buffer,
-     * and reallocate the keystroke buffer so that it has enough room
-     * for input. */
-    key_buffer_len += input_len;
-    key_buffer = (int *)nrealloc(key_buffer, key_buffer_len *
-	sizeof(int));
+    reserve_key_buffer(key_buffer_len + input_len);
 
-    /* If the keystroke buffer wasn't empty before, move its beginning
-     * forward far enough so that we can add input to its beginning. */
-    if (key_buffer_len > input_len)
-	memmove(key_buffer + input_len, key_buffer,
-		(key_buffer_len - input_len) * sizeof(int));
+    /* Step the start of the buffer back, and put input there. */
+    key_buffer_head = (key_buffer_head - input_len) & (key_buffer_size - 1);
+    key_buffer_len += input_len;
 
-    /* Copy input to the beginning of the keystroke buffer. */
-    memcpy(key_buffer, input, input_len * sizeof(int));
+    for (i = 0; i < input_len; i++)
+	key_buffer[(key_buffer_head + i) & (key_buffer_size - 1)] = input[i];
 }
 
 /* Put back the character stored in kbinput, putting it in byte range
@@ -256,6 +322,7 @@ void unget_kbinput(int kbinput, bool metakey, bool funckey)
 int *get_input(WINDOW *win, size_t input_len)
 {
     int *input;
+    size_t first;
 
     if (key_buffer_len == 0) {
 	if (win != NULL) {
@@ -272,33 +339,91 @@ int *get_input(WINDOW *win, size_t input_len)
     if (input_len > key_buffer_len)
 	input_len = key_buffer_len;
 
-    /* Subtract input_len from the length of the keystroke buffer, and
-     * allocate input so that it has enough room for input_len
-     * keystrokes. */
-    key_buffer_len -= input_len;
     input = (int *)nmalloc(input_len * sizeof(int));
 
     /* Copy input_len keystrokes from the beginning of the keystroke
-     * buffer into input. */
-    memcpy(input, key_buffer, input_len * sizeof(int));
+     * buffer into input, in two pieces when they wrap around. */
+    first = key_buffer_size - key_buffer_head;
+    if (first > input_len)
+	first = input_len;
 
-    /* If the keystroke buffer is empty, mark it as such. */
-    if (key_buffer_len == 0) {
-	free(key_buffer);
-	key_buffer = NULL;
-    /* If the keystroke buffer isn't empty, move its beginning forward
-     * far enough so that the keystrokes in input are no longer at its
-     * beginning. */
-    } else {
-	memmove(key_buffer, key_buffer + input_len, key_buffer_len *
-		sizeof(int));
-	key_buffer = (int *)nrealloc(key_buffer, key_buffer_len *
-		sizeof(int));
-    }
+    memcpy(input, key_buffer + key_buffer_head, first * sizeof(int));
+    memcpy(input + first, key_buffer, (input_len - first) * sizeof(int));
+
+    /* Move the start of the buffer beyond the keystrokes taken. */
+    key_buffer_len -= input_len;
+    key_buffer_head = (key_buffer_len == 0) ? 0 :
+		(key_buffer_head + input_len) & (key_buffer_size - 1);
 
     return input;
 }
 
+#ifndef NANO_TINY
+/* Read in the text of a bracketed paste, up to the end-of-paste marker,
+ * and return it as a string, storing its length in paste_len.  The
+ * keystrokes are taken from the keystroke buffer in bulk, so none of
+ * them gets interpreted as a shortcut.  Assume that the start-of-paste
+ * marker has already been read in. */
+char *get_bracketed_paste(size_t *paste_len)
+{
+    const int end_marker[PASTE_MARKER_LEN + 1] =
+		{ NANO_CONTROL_3, '[', '2', '0', '1', '~' };
+    size_t size = MAX_BUF_SIZE, matched = 0;
+	/* The allocated size of the text, and how much of the end
+	 * marker we have seen so far. */
+    char *paste = charalloc(size);
+
+    *paste_len = 0;
+
+    while (matched <= PASTE_MARKER_LEN) {
+	int *chunk;
+	size_t chunk_len, i;
+
+	if (key_buffer_len == 0)
+	    get_key_buffer(edit);
+
+	chunk_len = key_buffer_len;
+	chunk = get_input(NULL, chunk_len);
+
+	if (chunk == NULL)
+	    continue;
+
+	/* Make room for the whole chunk, plus a partial marker. */
+	while (*paste_len + chunk_len + PASTE_MARKER_LEN >= size)
+	    size *= 2;
+	paste = charealloc(paste, size);
+
+	for (i = 0; i < chunk_len && matched <= PASTE_MARKER_LEN; i++) {
+	    if (chunk[i] == end_marker[matched]) {
+		matched++;
+		continue;
+	    }
+
+	    /* What looked like the start of the end marker was ordinary
+	     * text after all, so keep it, minus the Escape. */
+	    if (matched > 1) {
+		memcpy(paste + *paste_len, "[201", matched - 1);
+		*paste_len += matched - 1;
+	    }
+	    matched = (chunk[i] == NANO_CONTROL_3) ? 1 : 0;
+
+	    /* Function keys and Escapes have no place in pasted text. */
+	    if (is_byte(chunk[i]) && chunk[i] != NANO_CONTROL_3)
+		paste[(*paste_len)++] = (char)chunk[i];
+	}
+
+	/* Put back whatever came after the end marker. */
+	unget_input(chunk + i, chunk_len - i);
+
+	free(chunk);
+    }
+
+    paste[*paste_len] = '\0';
+
+    return paste;
+}
+#endif /* !NANO_TINY */
+
 /* Read in a single character.  If it's ignored, swallow it and go on.
  * Otherwise, try to translate it from ASCII, meta key sequences, escape
  * sequences, and/or extended keypad values.  Supported extended keypad
@@ -926,8 +1051,21 @@ int convert_sequence(const int *seq, size_t seq_len)
 		    case '2':
 			if (seq_len >= 3) {
 			    switch (seq[2]) {
-				case '0': /* Esc [ 2 0 ~ == F9 on VT220/VT320/
-					   * Linux console/xterm/rxvt/Eterm. */
+				case '0':
+#ifndef NANO_TINY
+				    if (seq_len >= 5 && seq[4] == '~') {
+					if (seq[3] == '0')
+					    /* Esc [ 2 0 0 ~ == start of a
+					     * bracketed paste. */
+					    return START_OF_PASTE;
+					else if (seq[3] == '1')
+					    /* Esc [ 2 0 1 ~ == end of a
+					     * bracketed paste. */
+					    return END_OF_PASTE;
+				    }
+#endif
+				    /* Esc [ 2 0 ~ == F9 on VT220/VT320/
+				     * Linux console/xterm/rxvt/Eterm. */
 				    return KEY_F(9);
 				case '1': /* Esc [ 2 1 ~ == F10 on VT220/VT320/
 					   * Linux console/xterm/rxvt/Eterm. */
@@ -1114,6 +1252,14 @@ int parse_escape_sequence(WINDOW *win, int kbinput)
      * value, and save that as the result. */
     unget_input(&kbinput, 1);
     seq_len = get_key_buffer_len();
+#ifndef NANO_TINY
+    /* The start of a bracketed paste is followed by the pasted text,
+     * so take only the marker itself from the keystroke buffer. */
+    if (seq_len > PASTE_MARKER_LEN && peek_key_buffer(0) == '[' &&
+		peek_key_buffer(1) == '2' && peek_key_buffer(2) == '0' &&
+		peek_key_buffer(4) == '~')
+	seq_len = PASTE_MARKER_LEN;
+#endif
     seq = get_input(NULL, seq_len);
     retval = convert_sequence(seq, seq_len);
 
@@ -1632,27 +1778,23 @@ int get_mouseinput(int *mouse_x, int *mouse_y, bool allow_shortcuts)
  * the given sequence. */
 const sc *get_shortcut(int *kbinput)
 {
-    sc *s;
+    const sc *s;
 
 #ifdef DEBUG
     fprintf(stderr, "get_shortcut(): kbinput = %d, meta_key = %s -- ", *kbinput, meta_key ? "TRUE" : "FALSE");
 #endif
 
-    for (s = sclist; s != NULL; s = s->next) {
-	if ((s->menus & currmenu) && *kbinput == s->seq
-		&& meta_key == (s->type == META)) {
-#ifdef DEBUG
-	    fprintf (stderr, "matched seq \"%s\", and btw meta was %d (menu is %x from %x)\n",
-			     s->keystr, meta_key, currmenu, s->menus);
-#endif
-	    return s;
-	}
-    }
+    s = lookup_shortcut(currmenu, *kbinput, meta_key);
+
 #ifdef DEBUG
-    fprintf (stderr, "matched nothing, btw meta was %d\n", meta_key);
+    if (s != NULL)
+	fprintf (stderr, "matched seq \"%s\", and btw meta was %d (menu is %x from %x)\n",
+			 s->keystr, meta_key, currmenu, s->menus);
+    else
+	fprintf (stderr, "matched nothing, btw meta was %d\n", meta_key);
 #endif
 
-    return NULL;
+    return s;
 }
 
 /* Move to (x, y) in win, and display a line of n spaces with the
@@ -1734,8 +1876,43 @@ char *display_string(const char *buf, size_t start_col, size_t len, bool
 {
     size_t start_index;
 	/* Index in buf of the first character shown. */
-    size_t column;
-	/* Screen column that start_index corresponds to. */
+
+    /* If dollars is TRUE, make room for the "$" at the end of the
+     * line. */
+    if (dollars && len > 0 && strlenpt(buf) > start_col + len)
+	len--;
+
+    start_index = actual_x(buf, start_col);
+
+    return expand_string(buf, start_index, strnlenpt(buf, start_index),
+	start_col, len, dollars);
+}
+
+/* Do what display_string() does for the text of the given line, but
+ * find the first character shown without measuring all that precedes
+ * it when the line is a long one. */
+char *display_line(filestruct *line, size_t start_col, size_t len, bool
+	dollars)
+{
+    size_t start_index;
+
+    if (dollars && len > 0 && line_width(line) > start_col + len)
+	len--;
+
+    start_index = line_actual_x(line, start_col);
+
+    return expand_string(line->data, start_index, line_column(line,
+	start_index), start_col, len, dollars);
+}
+
+/* Convert buf, from start_index onward, into a string that shows len
+ * columns starting at start_col, where column is the column of
+ * start_index.  This is the heart of display_string(). */
+char *expand_string(const char *buf, size_t start_index, size_t column,
+	size_t start_col, size_t len, bool dollars)
+{
+    size_t end_col = start_col + len;
+	/* The column beyond which nothing needs converting. */
     size_t alloc_len;
 	/* The length of memory allocated for converted. */
     char *converted;
@@ -1745,19 +1922,11 @@ char *display_string(const char *buf, size_t start_col, size_t len, bool
     char *buf_mb;
     int buf_mb_len;
 
-    /* If dollars is TRUE, make room for the "$" at the end of the
-     * line. */
-    if (dollars && len > 0 && strlenpt(buf) > start_col + len)
-	len--;
-
     if (len == 0)
 	return mallocstrcpy(NULL, "");
 
     buf_mb = charalloc(mb_cur_max());
 
-    start_index = actual_x(buf, start_col);
-    column = strnlenpt(buf, start_index);
-
     assert(column <= start_col);
 
     /* Make sure there's enough room for the initial character, whether
@@ -1818,7 +1987,7 @@ char *display_string(const char *buf, size_t start_col, size_t len, bool
 #endif
     }
 
-    while (buf[start_index] != '\0') {
+    while (buf[start_index] != '\0' && start_col < end_col) {
 	buf_mb_len = parse_mbchar(buf + start_index, buf_mb, NULL);
 
 	if (mbwidth(buf + start_index) > 1)
@@ -2290,9 +2459,9 @@ void reset_cursor(void)
 	openfile->current_y = 0;
 
 	for (tmp = openfile->edittop; tmp && tmp != openfile->current; tmp = tmp->next)
-	    openfile->current_y += (strlenpt(tmp->data) / COLS) + 1;
+	    openfile->current_y += (line_width(tmp) / COLS) + 1;
 
-	openfile->current_y += xplustabs() / COLS;
+	openfile->current_y += xpt / COLS;
 	if (openfile->current_y < editwinrows)
 	    wmove(edit, openfile->current_y, xpt % COLS);
     } else
@@ -2318,10 +2487,10 @@ void edit_draw(filestruct *fileptr, const char *converted, int
 	line, size_t start)
 {
 #if !defined(NANO_TINY) || !defined(DISABLE_COLOR)
-    size_t startpos = actual_x(fileptr->data, start);
+    size_t startpos = line_actual_x(fileptr, start);
 	/* The position in fileptr->data of the leftmost character
 	 * that displays at least partially on the window. */
-    size_t endpos = actual_x(fileptr->data, start + COLS - 1) + 1;
+    size_t endpos = line_actual_x(fileptr, start + COLS - 1) + 1;
 	/* The position in fileptr->data of the first character that is
 	 * completely off the window to the right.
 	 *
@@ -2403,13 +2572,13 @@ void edit_draw(filestruct *fileptr, const char *converted, int
 		    else if (startmatch.rm_so < endpos &&
 			startmatch.rm_eo > startpos) {
 			x_start = (startmatch.rm_so <= startpos) ? 0 :
-				strnlenpt(fileptr->data,
+				line_column(fileptr,
 				startmatch.rm_so) - start;
 
 			index = actual_x(converted, x_start);
 
 			paintlen = actual_x(converted + index,
-				strnlenpt(fileptr->data,
+				line_column(fileptr,
 				startmatch.rm_eo) - start - x_start);
 
 			assert(0 <= x_start && 0 <= paintlen);
@@ -2438,7 +2607,7 @@ void edit_draw(filestruct *fileptr, const char *converted, int
 		    /* If the coloured part is scrolled off, skip it. */
 		    if (endmatch.rm_eo <= startpos)
 			goto tail_of_loop;
-		    paintlen = actual_x(converted, strnlenpt(fileptr->data,
+		    paintlen = actual_x(converted, line_column(fileptr,
 			endmatch.rm_eo) - start);
 		    mvwaddnstr(edit, line, 0, converted, paintlen);
 		    goto tail_of_loop;
@@ -2530,7 +2699,7 @@ void edit_draw(filestruct *fileptr, const char *converted, int
     fprintf(stderr, "  Marking for id %i  line %i as CWHOLELINE\n", tmpcolor->id, line);
 #endif
 		} else {
-		    paintlen = actual_x(converted, strnlenpt(fileptr->data,
+		    paintlen = actual_x(converted, line_column(fileptr,
 						endmatch.rm_eo) - start);
 		    fileptr->multidata[tmpcolor->id] = CBEGINBEFORE;
 #ifdef DEBUG
@@ -2561,7 +2730,7 @@ void edit_draw(filestruct *fileptr, const char *converted, int
 		    startmatch.rm_eo += start_col;
 
 		    x_start = (startmatch.rm_so <= startpos) ?
-				0 : strnlenpt(fileptr->data,
+				0 : line_column(fileptr,
 				startmatch.rm_so) - start;
 
 		    index = actual_x(converted, x_start);
@@ -2580,7 +2749,7 @@ void edit_draw(filestruct *fileptr, const char *converted, int
 			if (endmatch.rm_eo > startpos &&
 				endmatch.rm_eo > startmatch.rm_so) {
 			    paintlen = actual_x(converted + index,
-					strnlenpt(fileptr->data,
+					line_column(fileptr,
 					endmatch.rm_eo) - start - x_start);
 
 			    assert(0 <= x_start && x_start < COLS);
@@ -2668,7 +2837,7 @@ void edit_draw(filestruct *fileptr, const char *converted, int
 
 	    /* x_start is the expanded location of the beginning of the
 	     * mark minus the beginning of the page. */
-	    x_start = strnlenpt(fileptr->data, top_x) - start;
+	    x_start = line_column(fileptr, top_x) - start;
 
 	    /* If the end of the mark is off the page, paintlen is -1,
 	     * meaning that everything on the line gets painted.
@@ -2678,7 +2847,7 @@ void edit_draw(filestruct *fileptr, const char *converted, int
 	    if (bot_x >= endpos)
 		paintlen = -1;
 	    else
-		paintlen = strnlenpt(fileptr->data, bot_x) - (x_start +
+		paintlen = line_column(fileptr, bot_x) - (x_start +
 			start);
 
 	    /* If x_start is before the beginning of the page, shift
@@ -2726,7 +2895,7 @@ int update_line(filestruct *fileptr, size_t index)
 	filestruct *tmp;
 
 	for (tmp = openfile->edittop; tmp && tmp != fileptr; tmp = tmp->next)
-	    line += (strlenpt(tmp->data) / COLS) + 1;
+	    line += (line_width(tmp) / COLS) + 1;
     } else
 #endif
 	line = fileptr->lineno - openfile->edittop->lineno;
@@ -2744,15 +2913,15 @@ int update_line(filestruct *fileptr, size_t index)
 	index = 0;
     else
 #endif
-	index = strnlenpt(fileptr->data, index);
+	index = line_column(fileptr, index);
     page_start = get_page_start(index);
 
     /* Expand the line, replacing tabs with spaces, and control
      * characters with their displayed forms. */
 #ifdef NANO_TINY
-    converted = display_string(fileptr->data, page_start, COLS, TRUE);
+    converted = display_line(fileptr, page_start, COLS, TRUE);
 #else
-    converted = display_string(fileptr->data, page_start, COLS, !ISSET(SOFTWRAP));
+    converted = display_line(fileptr, page_start, COLS, !ISSET(SOFTWRAP));
 #ifdef DEBUG
     if (ISSET(SOFTWRAP) && strlen(converted) >= COLS - 2)
 	fprintf(stderr, "update_line(): converted(1) line = %s\n", converted);
@@ -2768,11 +2937,11 @@ int update_line(filestruct *fileptr, size_t index)
 #endif
 	if (page_start > 0)
 	    mvwaddch(edit, line, 0, '$');
-	if (strlenpt(fileptr->data) > page_start + COLS)
+	if (line_width(fileptr) > page_start + COLS)
 	    mvwaddch(edit, line, COLS - 1, '$');
 #ifndef NANO_TINY
     } else {
-	size_t full_length = strlenpt(fileptr->data);
+	size_t full_length = line_width(fileptr);
 	for (index += COLS; index <= full_length && line < editwinrows - 1; index += COLS) {
 	    line++;
 #ifdef DEBUG
@@ -2782,7 +2951,7 @@ int update_line(filestruct *fileptr, size_t index)
 
 	    /* Expand the line, replacing tabs with spaces, and control
 	     * characters with their displayed forms. */
-	    converted = display_string(fileptr->data, index, COLS, !ISSET(SOFTWRAP));
+	    converted = display_line(fileptr, index, COLS, !ISSET(SOFTWRAP));
 #ifdef DEBUG
 	    if (ISSET(SOFTWRAP) && strlen(converted) >= COLS - 2)
 		fprintf(stderr, "update_line(): converted(2) line = %s\n", converted);
@@ -2825,7 +2994,7 @@ void compute_maxrows(void)
     maxrows = 0;
     for (n = 0; n < editwinrows && foo; n++) {
 	maxrows++;
-	n += strlenpt(foo->data) / COLS;
+	n += line_width(foo) / COLS;
 	foo = foo->next;
     }
 
@@ -2871,7 +3040,7 @@ void edit_scroll(scroll_dir direction, ssize_t nlines)
 #ifndef NANO_TINY
 	/* Don't over-scroll on long lines. */
 	if (ISSET(SOFTWRAP) && direction == UPWARD) {
-	    ssize_t len = strlenpt(openfile->edittop->data) / COLS;
+	    ssize_t len = line_width(openfile->edittop) / COLS;
 	    i -= len;
 	    if (len > 0)
 		do_redraw = TRUE;
@@ -3050,7 +3219,7 @@ void edit_update(update_type location)
 	foo = foo->prev;
 #ifndef NANO_TINY
 	if (ISSET(SOFTWRAP) && foo)
-	    goal -= strlenpt(foo->data) / COLS;
+	    goal -= line_width(foo) / COLS;
 #endif
     }
     openfile->edittop = foo;
@@ -3110,7 +3279,7 @@ void do_cursorpos(bool constant)
     filestruct *f;
     char c;
     size_t i, cur_xpt = xplustabs() + 1;
-    size_t cur_lenpt = strlenpt(openfile->current->data) + 1;
+    size_t cur_lenpt = line_width(openfile->current) + 1;
     int linepct, colpct, charpct;
 
     assert(openfile->fileage != NULL && openfile->current != NULL);